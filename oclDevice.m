@@ -1,8 +1,10 @@
-classdef oclDevice
+classdef oclDevice < handle
     properties(SetAccess=protected)
+        Index (1,1) double % index into the (cached) device table
+    end
+    properties(Dependent, SetAccess=protected)
         Name (1,1) string
         Vendor (1,1) string
-        Index (1,1) double
         SupportsDouble (1,1) logical
         SupportsHalf  (1,1) logical
         DeviceVersion (1,1) string
@@ -16,13 +18,15 @@ classdef oclDevice
     properties(Constant)
         MaxGridSize (1,3) double = Inf
     end
-    properties(SetAccess=protected)
+    properties(Dependent, SetAccess=protected)
         TotalMemory (1,1) double
+        AvailableMemory (1,1) double % free global memory (bytes) - queried on access (NaN if the device does not report it)
         MultiprocessorCount (1,1) double
         ClockRateKHz (1,1) double
         DeviceSupported (1,1) logical
         DeviceAvailable (1,1) logical
         DeviceSelected (1,1) logical
+        ParentIndex (1,1) double % index of the parent device (0 for root devices)
     end
 
 
@@ -45,47 +49,114 @@ classdef oclDevice
             %
             % Note: some OpenCL compatiable devices do not support double-precision.
             %
+            % Note: D is a lightweight handle to the cached device table. Its
+            % properties are looked up when accessed.
+            %
             % See also oclDeviceTable, gpuArray, parallel.gpu.GPUDevice
             arguments
                 idx {mustBeNonnegative, mustBeInteger, mustBeScalarOrEmpty} = 0
             end
 
-            % get number of devices
-            N = oclDeviceCount();
-
             % get device index - select if requested
             idx = oclDevice.deviceSelection(idx);
 
-            % get the info from the device table
-            T = oclDevice.deviceInfo();
+            % empty if no device is selected
+            if isempty(idx), D = D([]); return; end
+            D.Index = idx;
+        end
+    end
 
-            % make this output roughly analgous to gpuDevice
-            % append other inferred properties to match gpuDevice
-            T.Index                 = (1:N)';
-            T.SupportsDouble        = arrayfun(@(c) ismember("cl_khr_fp64", c{1}), T.Extensions);
-            T.SupportsHalf          = arrayfun(@(c) ismember("cl_khr_fp16", c{1}), T.Extensions);
-            T.MaxThreadsPerBlock    = T.MaxWorkGroupSize;
-            T.MaxShmemPerBlock      = T.LocalMemSize;
-            T.MaxThreadBlockSize    = T.MaxWorkItemSizes;
-            T.TotalMemory           = T.GlobalMemSize;
-            T.MultiprocessorCount   = T.MaxComputeUnits;
-            T.ClockRateKHz          = T.MaxClockFrequency*1e3;
-            T.DeviceSupported       = true(N,1); % if we can see it, it's "supported"
-            T.DeviceAvailable       = T.Available;
-            T.DeviceSelected        = arrayfun(@(x) isequal(x, idx), T.Index);
-
-            % keep gpuDevice analagous fields only
-            S = table2struct(T);
-
-            % select active device
-            S = S(idx);
-
-            % re-init device
-            D = repmat(D, size(S));
-
-            % set the fields
-            bl = "MaxGridSize"; % blacklist
-            for f = setdiff(string(fieldnames(D)), bl)', [D.(f)] = S.(f); end
+    methods
+        % make this output roughly analgous to gpuDevice: each property is
+        % looked up from (or inferred from) the cached device table
+        function v = get.Name(D)              , v = D.info("Name"); end
+        function v = get.Vendor(D)            , v = D.info("Vendor"); end
+        function v = get.SupportsDouble(D)    , v = ismember("cl_khr_fp64", D.Extensions); end
+        function v = get.SupportsHalf(D)      , v = ismember("cl_khr_fp16", D.Extensions); end
+        function v = get.DeviceVersion(D)     , v = D.info("DeviceVersion"); end
+        function v = get.DriverVersion(D)     , v = D.info("DriverVersion"); end
+        function v = get.OpenclCVersion(D)    , v = D.info("OpenclCVersion"); end
+        function v = get.Extensions(D)        , v = D.info("Extensions"); v = v{1}; end
+        function v = get.MaxThreadsPerBlock(D), v = double(D.info("MaxWorkGroupSize")); end
+        function v = get.MaxShmemPerBlock(D)  , v = double(D.info("LocalMemSize")); end
+        function v = get.MaxThreadBlockSize(D), v = double(D.info("MaxWorkItemSizes")); end
+        function v = get.TotalMemory(D)       , v = double(D.info("GlobalMemSize")); end
+        function v = get.MultiprocessorCount(D), v = double(D.info("MaxComputeUnits")); end
+        function v = get.ClockRateKHz(D)      , v = double(D.info("MaxClockFrequency"))*1e3; end
+        function v = get.DeviceSupported(~)   , v = true; end % if we can see it, it's "supported"
+        function v = get.DeviceAvailable(D)   , v = D.info("Available"); end
+        function v = get.DeviceSelected(D)    , v = isequal(D.Index, oclDevice.deviceSelection()); end
+        function v = get.ParentIndex(D)       , v = double(D.info("ParentDevice")); end
+        function m = get.AvailableMemory(D)
+            m = oclDevice.availableMemory(D.Index);
+        end
+
+        function idx = partition(D, mode, vals)
+            %PARTITION - Partition a device into sub-devices
+            % IDX = PARTITION(D, "equally", N) partitions device D into as
+            % many sub-devices of N compute units each as fit.
+            %
+            % IDX = PARTITION(D, "counts", N) partitions device D into
+            % numel(N) sub-devices with N(i) compute units each.
+            %
+            % IDX = PARTITION(D, "affinity", DOMAIN) partitions device D along
+            % a shared cache or NUMA node, where DOMAIN is one of "numa",
+            % "l4", "l3", "l2", "l1", or "next".
+            %
+            % IDX are the indices of the new sub-devices, which are appended
+            % to the device table and can be selected with oclDevice(IDX(i)).
+            % Sub-devices last until the device list is refreshed.
+            %
+            % % Example: reserve 2 compute units of the CPU for the host
+            % D = oclDevice(oclDeviceCount("cpu"));
+            % idx = D.partition("counts", D.MultiprocessorCount - 2);
+            % oclDevice(idx(1));
+            %
+            % See also oclDeviceTable
+            arguments
+                D (1,1) oclDevice
+                mode (1,1) string {mustBeMember(mode, ["equally", "counts", "affinity"])}
+                vals {mustBeNonempty}
+            end
+            if mode == "affinity"
+                vals = validatestring(vals, ["numa", "l4", "l3", "l2", "l1", "next"]);
+            else
+                mustBeInteger(vals); mustBePositive(vals);
+            end
+            if ~exist('cl_get_device_info','file') || parallel.internal.pool.isPoolThreadWorker
+                error("oclDevice:partitionUnavailable", "Device partitioning requires cl_get_device_info on the client.");
+            end
+            idx = cl_get_device_info('partition', D.Index, char(mode), vals);
+            oclDevice.partitionLog({D.Index, char(mode), vals, max(idx)}); % for cl_launcher, or a cleared cl_get_device_info
+            oclDevice.deviceInfo("requery"); % include the sub-devices
+        end
+
+        function opts = profileOptions(D)
+            %PROFILEOPTIONS - Compiler options describing the device
+            % OPTS = PROFILEOPTIONS(D) returns "-D" options that define
+            % macros with the capabilities of device D, and the highest
+            % "-cl-std" that it supports, so that kernels can size tiles
+            % and vector widths for each device at compile time:
+            %
+            %   OCL_DEVICE_PREFERRED_VECTOR_WIDTH_<T> - T is one of CHAR,
+            %                            SHORT, INT, LONG, FLOAT, DOUBLE, HALF
+            %   OCL_DEVICE_LOCAL_MEM_SIZE            - bytes
+            %   OCL_DEVICE_GLOBAL_MEM_CACHELINE_SIZE - bytes
+            %   OCL_DEVICE_MAX_COMPUTE_UNITS
+            %   OCL_DEVICE_MAX_WORK_GROUP_SIZE
+            %   OCL_DEVICE_OPENCL_C_VERSION          - e.g. 120 for OpenCL C 1.2
+            %
+            % See also oclKernel
+            arguments, D (1,1) oclDevice, end
+            opts = oclDevice.deviceProfile(D.Index);
+        end
+    end
+
+    methods(Access=protected)
+        % row of the cached device table
+        function v = info(D, f)
+            T = oclDevice.deviceInfo();
+            v = T.(f)(D.Index,:);
         end
     end
 
@@ -96,7 +167,7 @@ classdef oclDevice
             
             persistent OCL_CURRENT_DEVICE_INDEX; % index
 
-            if idx > oclDeviceCount()
+            if ~isempty(idx) && idx > 0 && idx > oclDeviceCount()
                 error( ...
                     "oclDevice:invalidDeviceIndex", ...
                     "Invalid OpenCL device id: "+idx ...
@@ -109,11 +180,186 @@ classdef oclDevice
         end
 
         % cached call to oclDeviceTable
-        function T = deviceInfo()
+        % mode "cached"  - use the table in memory, else the on-disk snapshot
+        % mode "requery" - rebuild the table from the current device list
+        % mode "refresh" - re-enumerate devices (drops sub-devices)
+        function T = deviceInfo(mode)
+            arguments, mode (1,1) string {mustBeMember(mode, ["cached", "requery", "refresh"])} = "cached", end
             persistent T_;
-            if isempty(T_), T_ = oclDeviceTable(); end
+            if isempty(T_) || mode ~= "cached"
+                live = exist('cl_get_device_info','file') && ~parallel.internal.pool.isPoolThreadWorker;
+                if mode == "refresh" && live % re-enumerate devices
+                    cl_get_device_info('refresh');
+                    if exist('cl_launcher','file'), cl_launcher('refresh'); end
+                    oclDevice.partitionLog({});
+                    oclDevice.deviceProfile(); % reset
+                elseif live
+                    oclDevice.partitionSync("cl_get_device_info"); % e.g. after clear mex
+                end
+                T_ = [];
+                if live && mode == "cached", T_ = oclDevice.loadSnapshot(); end % on-disk snapshot
+                if isempty(T_)
+                    T_ = oclDeviceTable(); % live query
+                    if live && ~any(T_.ParentDevice), oclDevice.saveSnapshot(T_); end % root devices only
+                end
+            end
             T = T_;
         end
+
+        % sub-devices partitioned this session: {index, mode, values, last index}
+        function L = partitionLog(entry)
+            persistent L_;
+            if isempty(L_), L_ = cell(0,4); end
+            if nargin && isempty(entry), L_ = cell(0,4); % reset
+            elseif nargin, L_(end+1,:) = entry;
+            end
+            L = L_;
+        end
+
+        % replay partitions that the mex-file FCN ("cl_launcher" or
+        % "cl_get_device_info") has not seen: each mex-file holds its own
+        % device list, which is reset when it is cleared
+        function partitionSync(fcn)
+            arguments, fcn (1,1) string = "cl_launcher", end
+            L = oclDevice.partitionLog();
+            if isempty(L), return; end
+            n = feval(fcn, 'count');
+            for i = find([L{:,4}] > n)
+                feval(fcn, 'partition', L{i,1:3});
+            end
+        end
+
+        % compiler options with the capabilities of device IDX (see
+        % profileOptions) - queried once per device
+        function opts = deviceProfile(idx)
+            persistent P;
+            if ~nargin, P = {}; return; end % reset
+            if idx <= numel(P) && ~isempty(P{idx}), opts = P{idx}; return; end
+            opts = string.empty;
+            if ~exist('cl_get_device_info','file') || parallel.internal.pool.isPoolThreadWorker, return; end
+            oclDevice.partitionSync("cl_get_device_info"); % sub-devices (e.g. after clear mex)
+
+            % numeric capabilities (skipped where the query fails)
+            props = "CL_DEVICE_" + ["PREFERRED_VECTOR_WIDTH_" + ["CHAR", "SHORT", "INT", "LONG", "FLOAT", "DOUBLE", "HALF"], ...
+                "LOCAL_MEM_SIZE", "GLOBAL_MEM_CACHELINE_SIZE", "MAX_COMPUTE_UNITS", "MAX_WORK_GROUP_SIZE"];
+            c = cl_get_device_info(cellstr([props, "CL_DEVICE_OPENCL_C_VERSION", "CL_DEVICE_OPENCL_C_ALL_VERSIONS"]));
+            if idx > size(c, 2), return; end % not a device of the mex-file
+            c = c(:, idx);
+            for i = find(~cellfun(@isempty, c(1:numel(props))))'
+                opts(end+1) = "-DOCL_" + extractAfter(props(i), "CL_") + "=" + string(double(c{i})); %#ok<AGROW>
+            end
+
+            % highest OpenCL C version (all versions are listed from 3.0)
+            tok = regexp([char(c{end-1}), ' ', char(c{end})], 'OpenCL C (\d+)\.(\d+)', 'tokens');
+            v = max(cellfun(@(t) 100 * str2double(t(1)) + 10 * str2double(t(2)), [tok, {{'1', '0'}}]));
+            opts(end+1) = "-DOCL_DEVICE_OPENCL_C_VERSION=" + v;
+            if v >= 110, opts(end+1) = "-cl-std=CL" + floor(v/100) + "." + mod(v,100)/10; end
+
+            P{idx} = opts;
+        end
+
+        % free memory on device IDX from vendor extensions where they
+        % exist (NaN otherwise: OpenCL has no portable query)
+        function m = availableMemory(idx)
+            arguments, idx (1,1) double {mustBePositive, mustBeInteger}, end
+            m = NaN;
+            if exist('cl_get_device_info','file') && ~parallel.internal.pool.isPoolThreadWorker
+                oclDevice.partitionSync("cl_get_device_info"); % sub-devices (e.g. after clear mex)
+                c = cl_get_device_info({'CL_DEVICE_AVAILABLE_MEMORY'});
+                if idx <= numel(c) && ~isempty(c{idx}), m = double(c{idx}); end
+            end
+        end
+
+        % folder for on-disk caches
+        function d = cacheFolder()
+            d = string(getenv("MATLAB_OPENCL_CACHE"));
+            if d == "", d = fullfile(prefdir, "MatlabOpenCL"); end
+        end
+
+        % on-disk snapshot of the device table (one per host)
+        function T = loadSnapshot()
+            T = [];
+            fl = fullfile(oclDevice.cacheFolder(), "deviceTable_" + oclDevice.hostName() + ".mat");
+            if ~isfile(fl), return; end
+            try
+                S = load(fl, "T", "key");
+                if isequal(S.key, oclDevice.snapshotKey()), T = S.T; end
+            catch % corrupt or incompatible -> live query
+            end
+        end
+        function saveSnapshot(T)
+            fld = oclDevice.cacheFolder();
+            fl = fullfile(fld, "deviceTable_" + oclDevice.hostName() + ".mat");
+            key = oclDevice.snapshotKey(); %#ok<NASGU> saved
+            try
+                if ~isfolder(fld), mkdir(fld); end
+                tmp = fl + "." + feature('getpid') + ".tmp";
+                save(tmp, "T", "key");
+                movefile(tmp, fl, 'f'); % atomic replace
+            catch % read-only or unavailable -> no snapshot
+            end
+        end
+
+        % identify the OpenCL installation without enumerating devices:
+        % ICD vendor files, the libraries they name, kernel driver versions,
+        % and the environment variables that filter the visible devices
+        function key = snapshotKey()
+            env = ["OCL_ICD_VENDORS", "OCL_ICD_FILENAMES", "OPENCL_VENDOR_PATH", ...
+                "CUDA_VISIBLE_DEVICES", "ROCR_VISIBLE_DEVICES", "HIP_VISIBLE_DEVICES", ...
+                "GPU_DEVICE_ORDINAL", "ZE_AFFINITY_MASK"];
+            key = env + "=" + arrayfun(@(e) string(getenv(e)), env);
+
+            % ICD vendor libraries
+            if ispc
+                try libs = string(winqueryreg('name', 'HKEY_LOCAL_MACHINE', 'SOFTWARE\Khronos\OpenCL\Vendors'))';
+                catch, libs = string.empty;
+                end
+            elseif ismac
+                libs = "/System/Library/Frameworks/OpenCL.framework/OpenCL";
+            else
+                vdir = string(getenv("OCL_ICD_VENDORS"));
+                if vdir == "" || ~isfolder(vdir), vdir = "/etc/OpenCL/vendors"; end
+                icds = dir(fullfile(vdir, "*.icd"));
+                icds = vdir + "/" + string({icds.name});
+                libs = arrayfun(@(f) strip(string(fileread(f))), icds);
+                key = [key, icds];
+            end
+
+            % library sizes and modification times
+            sdirs = [split(string(getenv("LD_LIBRARY_PATH")), pathsep)', ...
+                "/usr/lib/x86_64-linux-gnu", "/usr/lib64", "/usr/lib", "/usr/local/lib"];
+            for l = libs
+                f = dir(l);
+                if isempty(f) && ~contains(l, ["/", "\"]) % search by name
+                    c = fullfile(sdirs(sdirs ~= ""), l);
+                    c = c(arrayfun(@isfile, c));
+                    if ~isempty(c), f = dir(c(1)); end
+                end
+                if isempty(f), key(end+1) = l; %#ok<AGROW> 
+                else, key(end+1) = join([l, f(1).bytes, f(1).date], "|"); %#ok<AGROW>
+                end
+            end
+
+            % kernel driver versions
+            if isunix && ~ismac
+                fls = ["/proc/driver/nvidia/version", "/sys/module/" + ["nvidia", "amdgpu", "i915", "xe"] + "/srcversion"];
+                for f = fls(arrayfun(@isfile, fls)), key(end+1) = f + "=" + strip(string(fileread(f))); end %#ok<AGROW>
+            end
+
+            % device query and table format
+            for f = string({which('cl_get_device_info'), which('oclDeviceTable')})
+                d = dir(f); if ~isempty(d), key(end+1) = join([f, d.date], "|"); end %#ok<AGROW>
+            end
+        end
+
+        % name of this host (snapshots may live on a shared file system)
+        function h = hostName()
+            h = string(getenv("COMPUTERNAME"));
+            if h == "" && isfile("/proc/sys/kernel/hostname"), h = strip(string(fileread("/proc/sys/kernel/hostname"))); end
+            if h == "", h = string(getenv("HOSTNAME")); end
+            if h == "", h = "localhost"; end
+            h = regexprep(h, "[^\w\-]", "_"); % valid file name
+        end
     end
 end
 
@@ -29,10 +29,10 @@ arguments
 end
 
 if ~exist('cl_get_device_info','file') || parallel.internal.pool.isPoolThreadWorker, N = 0; IDX = 1:N; return; end
-T = cl_get_device_info(cellstr(["CL_DEVICE_TYPE"]));
+T = oclDevice.deviceInfo(); % cached device table
 switch COUNTMODE
-    case "all", IDX = 1:numel(T);
-    otherwise,  IDX = find(contains(string(T),COUNTMODE));
+    case "all", IDX = 1:height(T);
+    otherwise,  IDX = find(contains(T.Type,COUNTMODE))';
 end
 N = numel(IDX);
 
@@ -10,12 +10,30 @@ function T = oclDeviceTable(props)
 % string array or a cell array of character vectors where each entry is
 % one of the properties returned by gpuDevice.
 % 
-% See also oclDeviceCount, oclDevice, gpuDeviceTable
+% % Example: Identify devices independent of the enumeration order
+% T = oclDeviceTable(["CL_DEVICE_NAME", "CL_DEVICE_STABLE_KEY", "CL_DEVICE_NUMA_NODE"]);
+% disp(sortrows(T, "StableKey"));
+%
+% The StableKey variable is derived from the PCI address, then the device
+% UUID, then the device name, whichever is available first. The NumaNode
+% variable is -1 where it is unknown.
+%
+% The Platform variable is the index of the device's platform in
+% OCLPLATFORMTABLE. Devices on the same platform can share an OpenCL
+% context.
+%
+% The ParentDevice variable is the index of the device a sub-device was
+% partitioned from (see oclDevice/partition), or 0 for a root device.
+% 
+% See also oclDeviceCount, oclDevice, oclPlatformTable, gpuDeviceTable
 
 arguments
-    props (1,:) string = subsref(getOclFields(),substruct('()',{1:17})) % first 19 fields
+    props (1,:) string = subsref(getOclFields(),substruct('()',{1:19})) % first 19 fields
 end
 
+% each property is queried once
+props = unique(props, 'stable');
+
 % field names (abbreviation)
 flds = props;
 flds = strrep(flds, "CL_DRIVER", "DRIVER");
@@ -24,35 +42,26 @@ pat = "CL_DEVICE_";
 i = startsWith(flds, pat);
 flds(i) = extractAfter(flds(i), pat);
 
-% query
+% query typed columns (one row per device)
 if ~exist('cl_get_device_info','file') || parallel.internal.pool.isPoolThreadWorker
-    out = cell(0,length(props));
+    S = cell2struct(repmat({zeros(0,1)}, [numel(props),1]), cellstr(props), 1);
 else
-    out = cl_get_device_info(cellstr(props))';
+    S = cl_get_device_info(cellstr(props), 'columns');
 end
 
-% get number of devices
-N = size(out,1);
-
 % turn snake_case into PascalCase (a.k.a. upper CamelCase)
-i1 = substruct('()', {1});
-cap = @(s) string(subsasgn(lower(char(s)), i1, upper(subsref(char(s), i1))));
-snake2camel = @(c) join(arrayfun(cap, split(c,'_')),"");
-flds = arrayfun(snake2camel, flds);
-
-% prepend index
-[out, flds] = deal([num2cell(1:N)', out], ["Index",flds]);
+flds = regexprep(lower(flds), "(?:^|_)(.)", "${upper($1)}");
 
 % format
-T = cell2table(out, 'VariableNames', flds);
+T = struct2table(S);
+T.Properties.VariableNames = cellstr(flds);
+
+% get number of devices
+N = height(T);
 
-% reformat char arrays into strings
+% prepend index
+T = addvars(T, (1:N)', 'Before', 1, 'NewVariableNames', "Index");
 tprops = string(T.Properties.VariableNames);
-for f = tprops
-    if iscellstr(T.(f)) %#ok<ISCLSTR>
-        T.(f) = cellfun(@string, T.(f)); 
-    end 
-end
 
 % parse the extensions for convenience
 if any(contains(tprops, "Extensions"))
@@ -81,7 +90,8 @@ function props = getOclFields()
 %% fields requested/returned within the mex function (OpenCL terminology)
 props = [
 "CL_DEVICE_NAME"
-... "CL_DEVICE_PLATFORM"
+"CL_DEVICE_PLATFORM"
+"CL_DEVICE_PARENT_DEVICE"
 "CL_DEVICE_VENDOR"
 "CL_DEVICE_TYPE"
 "CL_DEVICE_OPENCL_C_VERSION"
@@ -95,7 +105,6 @@ props = [
 "CL_DEVICE_MAX_CLOCK_FREQUENCY"
 "CL_DEVICE_AVAILABLE"
 "CL_DEVICE_MAX_MEM_ALLOC_SIZE"
-... "CL_DEVICE_MAX_GLOBAL_VARIABLE_SIZE"
 "CL_DEVICE_GLOBAL_MEM_CACHE_SIZE"
 "CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE"
 "CL_DEVICE_EXTENSIONS"
@@ -121,4 +130,26 @@ props = [
 "CL_DEVICE_QUEUE_ON_DEVICE_MAX_SIZE"
 "CL_DEVICE_QUEUE_ON_DEVICE_PREFERRED_SIZE"
 "CL_DEVICE_VENDOR_ID"
+... queried only where the device's CL_DEVICE_VERSION / extensions support them
+"CL_DEVICE_TYPE_BITFIELD"
+"CL_DEVICE_NUMERIC_VERSION"
+"CL_DEVICE_MAX_GLOBAL_VARIABLE_SIZE"
+"CL_DEVICE_SVM_CAPABILITIES"
+"CL_DEVICE_IL_VERSION"
+"CL_DEVICE_ILS_WITH_VERSION"
+"CL_DEVICE_SUB_GROUP_INDEPENDENT_FORWARD_PROGRESS"
+"CL_DEVICE_SUB_GROUP_SIZES_INTEL"
+"CL_DEVICE_ATOMIC_MEMORY_CAPABILITIES"
+"CL_DEVICE_ATOMIC_FENCE_CAPABILITIES"
+"CL_DEVICE_NON_UNIFORM_WORK_GROUP_SUPPORT"
+"CL_DEVICE_GENERIC_ADDRESS_SPACE_SUPPORT"
+"CL_DEVICE_PREFERRED_WORK_GROUP_SIZE_MULTIPLE"
+"CL_DEVICE_OPENCL_C_ALL_VERSIONS"
+"CL_DEVICE_PARTITION_MAX_SUB_DEVICES"
+"CL_DEVICE_PARTITION_AFFINITY_DOMAIN"
+... topology (from cl_khr_pci_bus_info, cl_amd/cl_nv_device_attribute_query, cl_khr_device_uuid)
+"CL_DEVICE_PCI_ADDRESS"
+"CL_DEVICE_UUID_KHR"
+"CL_DEVICE_NUMA_NODE"
+"CL_DEVICE_STABLE_KEY"
     ];
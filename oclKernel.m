@@ -15,6 +15,10 @@ classdef oclKernel < matlab.mixin.Copyable
     properties
         GlobalOffset    (1,3) double {mustBeInteger, mustBeNonnegative} = 0; % global range offset
     end
+    properties
+        Specialize (1,1) logical = false % compile in scalar arguments that repeat across calls
+        SpecializeAfter (1,1) double {mustBeInteger, mustBePositive} = 3 % number of calls with the same value before it is compiled in
+    end
     properties(Dependent, SetAccess=protected)
         MaxThreadsPerBlock (1,:) double % maximum number of concurrent work items
         NumRHSArguments (1,1) double % number of kernel inputs
@@ -28,9 +32,13 @@ classdef oclKernel < matlab.mixin.Copyable
         macros (1,:) string = string.empty % macros - will be prepended with '-D' when building
         include (1,:) string = string.empty % includes - will be prepended with '-I' when building
         opts (1,:) string = "-cl-" + ["mad-enable", "fp32-correctly-rounded-divide-sqrt"] % options passed to the OpenCL C compiler
+        MaxVariants (1,1) double {mustBeInteger, mustBeNonnegative} = 8 % number of build settings kept built (most recently used)
+        DeviceProfile (1,1) logical = false % define the device's capabilities as macros and use its highest -cl-std (see oclDevice/profileOptions)
+        SpecConstants (:,2) cell = cell(0,2) % {SpecId, value} pairs for a SPIR-V module - the class of a value sets its size, e.g. uint32(64)
     end
     properties(SetAccess=protected)
-        filename string % kernel filename
+        filename string % kernel filename ("" for source text)
+        Program oclProgram {mustBeScalarOrEmpty} = oclProgram.empty % shared program (if any)
     end
     properties(Hidden,SetAccess=protected)
         ioro (1,:) logical % inputs / outputs - read-only
@@ -38,11 +46,25 @@ classdef oclKernel < matlab.mixin.Copyable
         build_settings (1,1) string % cached compiler options string
         built_dev_ind (1,1) double % device index on (last) build
         built_stgs (1,:) string % device settings on (last) build
+        built_opts (1,1) string = "" % compiler options on (last) build, with any further settings
+        built_specs (:,2) cell = cell(0,2) % specialization constants on (last) build
+        prog_id (1,1) double = 0 % cl_launcher program handle on (last) build
+        headers (1,:) string = string.empty % headers included by the source (resolved)
+        source (1,1) string = "" % source text (if not from a file)
+        parsed_fp (1,1) string % fingerprint of the source and headers when parsed
+        built_fp (1,1) string % fingerprint of the source and headers on (last) build
+        variants (1,:) struct = oclKernel.noVariants() % built settings (key), handle (id) and fingerprint (fp) - most recent first
+        spec_vals (1,:) cell = {} % scalar arguments of the last call
+        spec_reps (1,:) double = [] % number of consecutive calls with these scalar arguments
+        spec_variants (1,:) struct = oclKernel.noVariants() % specialized variants (id < 0 if the build failed)
+        spec_pending (1,:) struct = oclKernel.noVariants() % specialized variants still compiling
+        arg_info struct = struct.empty % argument metadata from the driver (empty if unavailable)
+        arg_id (1,1) double = 0 % cl_launcher program handle of arg_info
         user_def_types (1,:) string {mustBeMember(user_def_types, ["uint8","uint16","uint32","uint64","int8","int16","int32","int64","single","double"])} = string.empty
     end
 
     methods
-        function kern = oclKernel(SRC, FUNC)
+        function kern = oclKernel(SRC, FUNC, kwargs)
             % oclKernel OpenCL Kernel object
             % 
             % kern = oclKernel(CL) and
@@ -73,107 +95,172 @@ classdef oclKernel < matlab.mixin.Copyable
             % kern = oclKernel('simpleEx.cl');
             % kern = oclKernel('simpleEx.cl', 'addToVector');
             %
-            % See also parallel.gpu.CUDAKernel
+            % kern = oclKernel(CL, FUNC, "BuildAsync", true) starts building the
+            % kernel in the background. feval waits for the build only if
+            % it has not yet finished.
+            %
+            % CL may also name a SPIR-V module (.spv or .spirv), built with
+            % clCreateProgramWithIL on devices that support it. The kernel
+            % signatures are read from an OpenCL C file of the same name
+            % next to it if there is one, or else from the module, where
+            % integers are signed and pointers that are never written are
+            % const (see defineTypes). Set the SpecConstants property to
+            % set specialization constants before the build.
+            %
+            % kern = oclKernel(PROG, FUNC) returns a kernel object that
+            % shares the compiled program of the oclProgram PROG, including
+            % its Device and build settings.
+            %
+            % If the Specialize property is true, scalar arguments that
+            % have the same value for SpecializeAfter consecutive calls are
+            % compiled into a variant of the kernel as constants, which is
+            % then launched instead while the values do not change. The
+            % variant is built in the background: the kernel is launched
+            % as built until the variant is ready.
+            %
+            % See also oclProgram, parallel.gpu.CUDAKernel
 
             arguments
-                SRC string % source code
+                SRC {mustBeA(SRC, ["string", "char", "cell", "oclProgram"])} % source code or program
                 FUNC string {mustBeScalarOrEmpty} = string.empty % function name
+                kwargs.BuildAsync (1,1) logical = false % start building in the background
             end
 
-            % if this is a file we can find
-            if isscalar(SRC) && exist(SRC, 'file')
-                filename = which(SRC); % file we can find
-            else % write to temp file
-                filename = string(tempname) + ".cl";
-                writelines(SRC, filename);
-            end % get full path
-
-            % read the code
-            lns = readlines(filename);
-
-            % parse code
-            cod = lns;
-            i = contains(lns,"//");
-            cod(i) = arrayfun(@(l) extractBefore(l, "//"), cod(i)); % remove C line comments
-            cod(startsWith(cod, "#")) = []; % delete lines starting with '#'
-            cod = join(cod,'\n');
-            cod = eraseBetween(cod,"/*","*/",'Boundaries','inclusive'); % remove C block comments
-            cod = string(split(cod, '\n'));
-            % cod = join(cod); % combine with spaces
-
-            % CL kernel pattern
-            if isempty(FUNC), fnm = alphanumericsPattern; else, fnm = FUNC; end
-            pat = "kernel void" + whitespacePattern + fnm + "(" ...
-            + (asManyOfPattern(alphanumericsPattern|whitespacePattern|","|"*"|"_"|"["|"]")) ...
-            + lookAheadBoundary(")");
+            % parse the code, or share the program's
+            if isa(SRC, 'oclProgram')
+                prog = SRC;
+                filename = prog.filename;
+                source = prog.source;
+                nfcns = prog.KernelNames;
+                hfcns = prog.signatures;
+            else
+                prog = oclProgram.empty;
+                [filename, nfcns, hfcns, source] = oclKernel.parseSource(SRC);
+            end
 
             % soft validate that ~a~ kernel exists and is probably valid
-            if ~contains(join(cod), pat)
-                error("oclKernel:invalidKernel",join(["Cannot find any kernels", "matching '"+FUNC+"'", "in file "+filename+"."]));
+            if isempty(nfcns)
+                error("oclKernel:invalidKernel","Cannot find any kernels in "+oclKernel.sourceLabel(filename)+".");
             end
 
-            % get the matching kernel function signatures
-            hfcns = extract(join(cod), pat); % signature line
-            nfcns = extractBefore(extract(hfcns, alphanumericsPattern + "("), "("); % function names
-
             % parse function name
             if isempty(FUNC)
                 if ~isscalar(nfcns), error("oclKernel:ambiguousKernel", "The kernel must be specified - the detected kernels are {" + join(nfcns, ", ") + "}.");
                 end
             else
-                if (FUNC == nfcns) % empty -> fail
-                else, error("oclKernel:kernelNotFound","The requested kernel ("+FUNC+") was not found -  the detected kernels are {" + join(nfcns, ", ") + "}.");
+                i = find(FUNC == nfcns, 1);
+                if isempty(i), error("oclKernel:kernelNotFound","The requested kernel ("+FUNC+") was not found -  the detected kernels are {" + join(nfcns, ", ") + "}.");
                 end
+                nfcns = nfcns(i);
+                hfcns = hfcns(i);
             end
 
-            % parse number of inputs and read/write map
-            % TODO: handle attributes with arguments e.g. '__attr__((val))'
-            inps = split(extractAfter(hfcns,"("), ",")';
-            ro = contains(inps, "const"); % read-only
-
-            % include the (modified) path
-            inc = string(split(path(), pathsep));
-            inc = inc(~startsWith(inc, matlabroot));
-
             % create the oclKernel
             kern.filename = filename;
+            kern.source   = source;
             kern.funcname = nfcns;
-            kern.Device   = oclDevice();
 
             % set kernel info
-            kern.ioro = ro;
-            kern.signature = hfcns;
-            kern.include = inc; % default 
+            setSignature(kern, hfcns);
+
+            if isempty(prog)
+                % include only the folders of the headers used
+                [inc, kern.headers] = oclKernel.resolveIncludes(filename, source);
+                kern.parsed_fp = oclKernel.fingerprint([kern.filename, kern.headers]);
+
+                kern.Device  = oclDevice();
+                kern.include = inc; % default
+            else
+                kern.Program = prog; % shares the device and build settings
+            end
+
+            % start building: feval waits for the build if needed
+            if kwargs.BuildAsync && ~kern.built, build(kern, string.empty, "wait", false); end
         end
 
-        function kern = build(kern, stgs)
+        function kern = build(kern, stgs, kwargs)
+            %BUILD - Build the kernels
+            % build(KERN) builds every kernel in the oclKernel array KERN.
+            % The programs are compiled concurrently.
+            %
+            % build(KERN, STGS) appends the compiler options STGS.
+            %
+            % build(..., "wait", false) returns while the programs are
+            % compiling. A kernel waits for its build when it is launched.
+            %
+            % build also picks up edits of the source file or its headers,
+            % which feval does not check for: call build after an edit.
+            %
+            % See also oclProgram/build
             arguments
                 kern oclKernel
                 stgs (1,:) string = string.empty % further settings
+                kwargs.wait (1,1) logical = true % wait for the builds to complete
             end
 
-            % for each kernel ...
+            % match the launcher's devices to the device table
+            oclDevice.partitionSync("cl_launcher");
+
+            % start every build: programs compile concurrently in the launcher
+            done = oclProgram.empty; % shared programs built
             for i = 1:numel(kern)
                 % get kernel
                 k = kern(i);
 
+                % shared programs are built once for all of their kernels
+                if ~isempty(k.Program)
+                    if ~any(done == k.Program), build(k.Program, stgs, "wait", false); done(end+1) = k.Program; end %#ok<AGROW>
+                    i = find(k.Program.KernelNames == k.funcname, 1);
+                    if ~isempty(i), setSignature(k, k.Program.signatures(i)); end % as (re-)parsed
+                    continue;
+                end
+
+                % pick up edits of the source or its headers
+                fp = oclKernel.fingerprint([k.filename, k.headers]);
+                if fp ~= k.parsed_fp, reparse(k); fp = k.parsed_fp; end
+
                 % get compilation settings (with build first)
                 s = [k.build_settings, stgs];
 
-                % compile only
-                [~, okn] = cl_run_kernel(double(k.Device.Index), char(k.filename), char(join(s)));
+                % switch to a resident variant, or compile one: the program
+                % stays resident in the launcher until evicted
+                key = k.Device.Index + "|" + join(s) + oclKernel.specKey(k.SpecConstants);
+                [k.variants, h] = oclKernel.variantLookup(k.variants, key, fp);
+                if ~h
+                    h = oclKernel.startBuild(k.Device.Index, k.filename, k.source, join(s), k.headers, k.SpecConstants);
+                    [k.variants, old] = oclKernel.variantInsert(k.variants, key, h, fp, k.MaxVariants);
+                    for o = old, cl_launcher('release', o); end
+                end
+                k.prog_id = h;
+
+                % save build settings
+                k.built_dev_ind = k.Device.Index;
+                k.built_stgs    = k.build_settings;
+                k.built_opts    = join(s);
+                k.built_specs   = k.SpecConstants;
+                k.built_fp      = fp;
+            end
+            if ~kwargs.wait, return; end
+
+            % wait for each build
+            for p = done, wait(p); end
+            for i = find(arrayfun(@(k) isempty(k.Program), kern(:)'))
+                k = kern(i);
+                try
+                    okn = string(cl_launcher('wait', k.prog_id));
+                catch ME
+                    k.built_dev_ind = 0; % not built
+                    k.variants([k.variants.id] == k.prog_id) = [];
+                    rethrow(ME);
+                end
 
                 % ensure that the kernel was included
                 if ~(ismember(k.funcname, okn))
                     error( ...
                         "oclKernel:kernelNotFound", "Expected to find kernel " + k.funcname + ...
-                        " but instead the kernels found were {" + okn + "}." ...
+                        " but instead the kernels found were {" + join(okn, ", ") + "}." ...
                         );
                 end
-
-                % save build settings
-                k.built_dev_ind = k.Device.Index;
-                k.built_stgs    = k.build_settings;
             end
         end
 
@@ -213,6 +300,10 @@ classdef oclKernel < matlab.mixin.Copyable
             % y1 and y2, correspond to the values of pInOut1 and pInOut2 after the
             % CUDA kernel has executed.
             %
+            % Where the driver reports the argument metadata, a local
+            % pointer argument is allocated per work-group with the size in
+            % bytes of the array passed for it, whose contents are unused.
+            %
             % See also parallel.gpu.CUDAKernel/feval
             arguments
                 kern (1,1) oclKernel
@@ -225,7 +316,20 @@ classdef oclKernel < matlab.mixin.Copyable
             end
 
             % if not built, build the kernel with defaults 
-            if ~kern.built, kern = build(kern); end
+            if ~kern.built
+                try
+                    kern = build(kern);
+                catch ME % a resident variant is stale: the launcher was cleared
+                    if ME.identifier ~= "MatCL:cl_launcher:InvalidHandle", rethrow(ME); end
+                    forgetHandles(kern);
+                    kern = build(kern);
+                end
+            end
+
+            % argument metadata from the driver (once per build): when
+            % known, arguments are passed exactly as declared
+            if kern.arg_id ~= kern.prog_id, argInfo(kern); end
+            exact = ~isempty(kern.arg_info);
 
             % validate inputs with the signature
             if numel(varargin) ~= numel(kern.ioro)
@@ -269,10 +373,20 @@ classdef oclKernel < matlab.mixin.Copyable
 
                 % cast recognized types, and recast unrecognized types
                 i = logical(cellfun(@(t) exist(t,'builtin'), typs(2,:))); % whether recognized
-                varargout( i) = cellfun(@(x,T) cast(x,T       ), varargout( i), typs(2, i), 'UniformOutput',0);
-                varargout(~i) = cellfun(@(x,T) cast(x,'like',x), varargout(~i), typs(2,~i), 'UniformOutput',0);
+                if exact % the launcher copies the inputs: cast mismatched classes only
+                    i = i & ~cellfun(@isa, varargout, typs(2,:));
+                    varargout(i) = cellfun(@(x,T) cast(x,T), varargout(i), typs(2,i), 'UniformOutput',0);
+                else
+                    varargout( i) = cellfun(@(x,T) cast(x,T       ), varargout( i), typs(2, i), 'UniformOutput',0);
+                    varargout(~i) = cellfun(@(x,T) cast(x,'like',x), varargout(~i), typs(2,~i), 'UniformOutput',0);
+                end
             end
 
+            if exact
+                % the launcher passes pointers by buffer whatever the size
+                ro = kern.ioro | endsWith(kern.ArgumentTypes, " scalar"); % scalars are always read-only
+                so = false(size(ro));
+            else
             % HACK: work-around a bug in MatCL (since I legally can't fix it ...):
             % if an argument is a const (input) pointer (vector) but the
             % MATLAB input data is scalar, set it to R/W so that MatCL
@@ -290,14 +404,27 @@ classdef oclKernel < matlab.mixin.Copyable
             so = startsWith(kern.ArgumentTypes, "inout ") ... data is an output
                 & endsWith(kern.ArgumentTypes, " vector") ... kernel wants pointer
                 & cellfun(@isscalar, varargout); ... MATLAB data is scalar
+            end
             
             % append 0 to the argument to make it a vector
             varargout(so) = cellfun(@(arg) [arg, 0], varargout(so), 'UniformOutput', 0);
 
-            % launch the kernel
-            cl_run_kernel(double(kern.Device.Index), cellstr(kern.funcname), ...
-                [kern.GlobalOffset, kern.GlobalSize], kern.ThreadBlockSize, ...
-                varargout{:}, double(ro));
+            % dispatch to a variant with repeated scalars compiled in (opt-in)
+            h = kern.prog_id;
+            if kern.Specialize && ~oclKernel.isIL(kern.filename), h = specialize(kern, varargout); end
+
+            % launch the kernel: only an enqueue on the resident program
+            args = {char(kern.funcname), [kern.GlobalOffset, kern.GlobalSize], kern.ThreadBlockSize};
+            try
+                [varargout{~ro}] = cl_launcher('launch', h, args{:}, varargout{:}, double(ro));
+            catch ME
+                % the launcher was cleared (handles of an older generation
+                % are rejected) - rebuild and retry
+                if ME.identifier ~= "MatCL:cl_launcher:InvalidHandle", rethrow(ME); end
+                forgetHandles(kern);
+                kern = build(kern);
+                [varargout{~ro}] = cl_launcher('launch', kern.prog_id, args{:}, varargout{:}, double(ro));
+            end
 
             % don't return read-only arguments
             ro = kern.ioro == 1; % read-only
@@ -312,6 +439,25 @@ classdef oclKernel < matlab.mixin.Copyable
             varargout(so) = cellfun(@(arg) arg(1), varargout(so), 'UniformOutput', 0);
         end
 
+        function release(kern)
+            %RELEASE - Release the built programs
+            % release(KERN) releases the programs built for the kernels in
+            % KERN, including those kept for other build settings (see
+            % MaxVariants). A kernel is rebuilt when it is next launched.
+            %
+            % See also oclProgram/release
+            arguments, kern oclKernel, end
+            for k = kern(:)'
+                for h = [k.spec_variants.id, k.spec_pending.id], cl_launcher('release', h); end
+                k.spec_variants = oclKernel.noVariants();
+                k.spec_pending  = oclKernel.noVariants();
+                if ~isempty(k.Program), release(k.Program); continue; end
+                for h = [k.variants.id], cl_launcher('release', h); end
+                k.variants = oclKernel.noVariants();
+                k.built_dev_ind = 0; % not built
+            end
+        end
+
         function defineTypes(kern, types, aliases)
             arguments
                 kern (1,1) oclKernel
@@ -340,9 +486,60 @@ classdef oclKernel < matlab.mixin.Copyable
 
         % Dependent, Vector
         function tf = get.built(kern)
-            tf = cellfun(@eq     , {kern.Device.Index  }, {kern.built_dev_ind}) ...
-            &    cellfun(@isequal, {kern.build_settings}, {kern.built_stgs}   );
-            tf = reshape(tf, size(kern));
+            tf = false(size(kern));
+            for i = 1:numel(kern)
+                k = kern(i); % or its shared program
+                if ~isempty(k.Program), k = k.Program; end
+                tf(i) = isequal(k.Device.Index, k.built_dev_ind) && isequal(k.build_settings, k.built_stgs) ...
+                    && isequal(k.SpecConstants, k.built_specs); % files are checked by build (no I/O per launch)
+            end
+        end
+
+        % shared program state and settings
+        function h = get.prog_id(kern)
+            if isempty(kern.Program), h = kern.prog_id; else, h = kern.Program.prog_id; end
+        end
+        function d = get.Device(kern)
+            if isempty(kern.Program), d = kern.Device; else, d = kern.Program.Device; end
+        end
+        function set.Device(kern, d)
+            if isempty(kern.Program), kern.Device = d; else, kern.Program.Device = d; end %#ok<MCSUP>
+        end
+        function v = get.macros(kern)
+            if isempty(kern.Program), v = kern.macros; else, v = kern.Program.macros; end
+        end
+        function set.macros(kern, v)
+            if isempty(kern.Program), kern.macros = v; else, kern.Program.macros = v; end %#ok<MCSUP>
+        end
+        function v = get.include(kern)
+            if isempty(kern.Program), v = kern.include; else, v = kern.Program.include; end
+        end
+        function set.include(kern, v)
+            if isempty(kern.Program), kern.include = v; else, kern.Program.include = v; end %#ok<MCSUP>
+        end
+        function v = get.opts(kern)
+            if isempty(kern.Program), v = kern.opts; else, v = kern.Program.opts; end
+        end
+        function set.opts(kern, v)
+            if isempty(kern.Program), kern.opts = v; else, kern.Program.opts = v; end %#ok<MCSUP>
+        end
+        function v = get.DeviceProfile(kern)
+            if isempty(kern.Program), v = kern.DeviceProfile; else, v = kern.Program.DeviceProfile; end
+        end
+        function set.DeviceProfile(kern, v)
+            if isempty(kern.Program), kern.DeviceProfile = v; else, kern.Program.DeviceProfile = v; end %#ok<MCSUP>
+        end
+        function v = get.SpecConstants(kern)
+            if isempty(kern.Program), v = kern.SpecConstants; else, v = kern.Program.SpecConstants; end
+        end
+        function set.SpecConstants(kern, v)
+            if isempty(kern.Program), kern.SpecConstants = v; else, kern.Program.SpecConstants = v; end %#ok<MCSUP>
+        end
+        function v = get.MaxVariants(kern)
+            if isempty(kern.Program), v = kern.MaxVariants; else, v = kern.Program.MaxVariants; end
+        end
+        function set.MaxVariants(kern, v)
+            if isempty(kern.Program), kern.MaxVariants = v; else, kern.Program.MaxVariants = v; end %#ok<MCSUP>
         end
 
         % Dependent, Scalar
@@ -370,7 +567,8 @@ classdef oclKernel < matlab.mixin.Copyable
             s = join([
                 "-I" + kern.include, ...
                 "-D" + kern.macros , ...
-                       kern.opts     ...
+                       kern.opts   , ...
+                       oclKernel.profileSettings(kern) ...
                 ]);
         end
 
@@ -386,10 +584,20 @@ classdef oclKernel < matlab.mixin.Copyable
 
             % get vector vs. scalar
             isptr = contains(inps, ["*", "["+whitespacePattern(0,Inf)+digitsPattern+whitespacePattern(0,Inf)+"]"]); % pointer vs. constant
+            if ~isempty(kern.arg_info) % as declared
+                isptr = ismember(string({kern.arg_info.address}), ["global", "constant", "local"]);
+            end
             typs(3, isptr) = "vector";
             typs(3,~isptr) = "scalar";
 
-            if isempty(kern.user_def_types)
+            if ~isempty(kern.user_def_types)
+                typs(2,:) = kern.user_def_types;
+            elseif ~isempty(kern.arg_info)
+                % type names as resolved by the compiler
+                dtyps = strip(erase(string({kern.arg_info.type}), "*"));
+                dtyps = erase(dtyps, digitsPattern(1,2) + textBoundary("end")); % vector types e.g. uchar2 -> uchar
+                typs(2,:) = string(arrayfun(@oclKernel.matlabType, dtyps, 'UniformOutput', false));
+            else
                 % identify data type automatically
                 attr = "__"+wildcardPattern+"__"; % attribute pattern
                 qual = pattern(["__";"";"__"] + ["global", "const", "constant", "local", "private", "volatile"]+["";"";"__"]); % qualifiers
@@ -404,29 +612,444 @@ classdef oclKernel < matlab.mixin.Copyable
                 dtyps = erase(dtyps, digitsPattern(1,2) + textBoundary("end")); % vector types e.g. uchar2 -> uchar
 
                 % convert type via translation table (optional)
-                for i = 1:numel(dtyps)
-                    switch dtyps(i)
-                        case {"uchar"  , "unsigned char" }, t = "uint8" ;
-                        case {"ushort" , "unsigned short"}, t = "uint16";
-                        case {"uint"   , "unsigned int"  }, t = "uint32";
-                        case {"ulong"  , "unsigned long" }, t = "uint64";
-                        case {"char"                     }, t = "int8"  ;
-                        case {"short"                    }, t = "int16" ;
-                        case {"int"                      }, t = "int32" ;
-                        case {"long"                     }, t = "int64" ;
-                        case {"double", "single", "half" }, t = dtyps(i); % identical
-                        otherwise, t = dtyps(i); % macro or template -> no translation
-                    end
-                    typs(2,i) = t;
-                end
-            else
-                typs(2,:) = kern.user_def_types;
+                typs(2,:) = string(arrayfun(@oclKernel.matlabType, dtyps, 'UniformOutput', false));
             end
 
             % convert to cell
             typs = cellstr(join(typs,1));
         end
     end
+
+    methods(Access=protected)
+        % set the C declaration signature and the read-only map
+        function setSignature(kern, sig)
+            arguments, kern (1,1) oclKernel, sig (1,1) string, end
+
+            % parse number of inputs and read/write map
+            % TODO: handle attributes with arguments e.g. '__attr__((val))'
+            inps = split(extractAfter(sig,"("), ",")';
+            kern.ioro = contains(inps, "const"); % read-only
+            kern.signature = sig;
+            kern.arg_id = 0; % re-read the argument metadata
+        end
+
+        % argument metadata of the built kernel from the driver (see
+        % cl_launcher 'args'): pointers to const or constant data are
+        % read-only, whatever the signature text, and local memory is
+        % never an output
+        function argInfo(kern)
+            arguments, kern (1,1) oclKernel, end
+            try
+                info = cl_launcher('args', kern.prog_id, char(kern.funcname));
+            catch
+                info = struct.empty; % e.g. a stale handle: launching rebuilds
+            end
+            if numel(info) ~= numel(kern.ioro), info = struct.empty; end % unavailable or mismatched
+            kern.arg_info = info;
+            kern.arg_id = kern.prog_id;
+            if isempty(info), return; end
+
+            addr = string({info.address});
+            ptr = addr == "global" | addr == "constant"; % buffers
+            ro = contains(string({info.qualifier}), "const") | addr == "constant";
+            kern.ioro(ptr) = ro(ptr);
+            kern.ioro(addr == "local") = true;
+        end
+
+        % handle of the program to launch for these arguments: scalars that
+        % repeat for SpecializeAfter calls are compiled in as constants
+        function h = specialize(kern, args)
+            arguments, kern (1,1) oclKernel, args (1,:) cell, end
+
+            % count consecutive calls with the same (finite, real) scalars
+            isscl = endsWith(kern.ArgumentTypes, " scalar") ...
+                & cellfun(@(x) isscalar(x) && isreal(x) && isfinite(x), args);
+            if numel(kern.spec_vals) ~= numel(args), kern.spec_vals = cell(size(args)); kern.spec_reps = zeros(size(args)); end
+            rep = isscl & cellfun(@isequal, args, kern.spec_vals);
+            kern.spec_reps = (kern.spec_reps + 1) .* rep + ~rep .* isscl;
+            kern.spec_vals(:) = {[]}; kern.spec_vals(isscl) = args(isscl);
+
+            % generic program unless some scalars have settled
+            h = kern.prog_id;
+            i = find(isscl & kern.spec_reps >= kern.SpecializeAfter);
+            if isempty(i), return; end
+
+            % variant for these values (on the current build)
+            b = kern; if ~isempty(kern.Program), b = kern.Program; end
+            vals = cellfun(@oclKernel.literal, args(i), 'UniformOutput', false);
+            key = b.built_dev_ind + "|" + b.built_opts + "|" + join(i + "=" + string(vals), ";");
+            [kern.spec_variants, hs] = oclKernel.variantLookup(kern.spec_variants, key, b.built_fp);
+            if hs > 0, h = hs; end
+            if hs, return; end % built, or failed (-1)
+
+            % variants compile in the background: the generic program is
+            % launched until the variant is ready
+            try
+                [kern.spec_pending, hs] = oclKernel.variantLookup(kern.spec_pending, key, b.built_fp);
+                if ~hs
+                    if b.filename == "", src = b.source; else, src = fileread(b.filename); end
+                    src = oclKernel.specializeSource(src, kern.funcname, i, vals);
+                    stgs = b.built_opts; % as built, with the settings passed to build
+                    if b.filename ~= "", stgs = join(["-I" + fileparts(b.filename), stgs]); end % relative includes
+                    hs = oclKernel.startBuild(b.built_dev_ind, "", src, stgs, b.headers);
+                    [kern.spec_pending, old] = oclKernel.variantInsert(kern.spec_pending, key, hs, b.built_fp, kern.MaxVariants);
+                    for o = old, cl_launcher('release', o); end
+                end
+                if ~cl_launcher('ready', hs), return; end
+            catch ME
+                warning("oclKernel:specializeFailed", "Unable to specialize kernel " + kern.funcname + ...
+                    " - using the generic kernel:" + newline + ME.message);
+                hs = -1; % don't retry
+            end
+
+            % ready (or failed): move to the built variants
+            j = [kern.spec_pending.key] == key;
+            if hs < 0, for o = [kern.spec_pending(j).id], cl_launcher('release', o); end, end
+            kern.spec_pending(j) = [];
+            [kern.spec_variants, old] = oclKernel.variantInsert(kern.spec_variants, key, hs, b.built_fp, kern.MaxVariants);
+            for o = old, cl_launcher('release', o); end
+            if hs > 0, h = hs; end
+        end
+
+        % copies hold no launcher handles: each holder releases its own
+        % (a copy rebuilds, which reuses the resident program)
+        function cp = copyElement(kern)
+            cp = copyElement@matlab.mixin.Copyable(kern);
+            cp.variants = oclKernel.noVariants();
+            cp.spec_variants = oclKernel.noVariants();
+            cp.spec_pending  = oclKernel.noVariants();
+            cp.built_dev_ind = 0; % not built
+            cp.arg_id = 0;
+        end
+
+        % forget every launcher handle after the launcher was cleared or
+        % refreshed: all of them are stale, so none is released
+        function forgetHandles(kern)
+            arguments, kern (1,1) oclKernel, end
+            if isempty(kern.Program), kern.variants = oclKernel.noVariants();
+            else, kern.Program.variants = oclKernel.noVariants();
+            end
+            kern.spec_variants = oclKernel.noVariants();
+            kern.spec_pending  = oclKernel.noVariants();
+        end
+
+        % re-parse an edited source: signature and headers
+        function reparse(kern)
+            arguments, kern (1,1) oclKernel, end
+            if kern.filename == "", src = kern.source; else, src = kern.filename; end
+            [~, nms, sigs] = oclKernel.parseSource(src);
+            i = find(nms == kern.funcname, 1);
+            if isempty(i)
+                error("oclKernel:kernelNotFound", "The kernel " + kern.funcname + " was removed from " + oclKernel.sourceLabel(kern.filename) + ".");
+            end
+            setSignature(kern, sigs(i));
+            [inc, kern.headers] = oclKernel.resolveIncludes(kern.filename, kern.source);
+            kern.include = unique([kern.include, inc], 'stable'); % add any new folders
+            kern.parsed_fp = oclKernel.fingerprint([kern.filename, kern.headers]);
+        end
+    end
+
+    methods(Static, Hidden)
+        % MATLAB class of an OpenCL C type name (unchanged if none)
+        function t = matlabType(t)
+            switch t
+                case {"uchar"  , "unsigned char" }, t = "uint8" ;
+                case {"ushort" , "unsigned short"}, t = "uint16";
+                case {"uint"   , "unsigned int"  }, t = "uint32";
+                case {"ulong"  , "unsigned long" }, t = "uint64";
+                case {"char"                     }, t = "int8"  ;
+                case {"short"                    }, t = "int16" ;
+                case {"int"                      }, t = "int32" ;
+                case {"long"                     }, t = "int64" ;
+                otherwise % identical, or a macro or template -> no translation
+            end
+        end
+
+        % fingerprint of files: size and modification time of each
+        function fp = fingerprint(files)
+            arguments, files (1,:) string, end
+            fp = "";
+            for f = files(files ~= "") % source text cannot change
+                d = dir(f);
+                if isscalar(d), fp = fp + sprintf("%s|%d|%.17g;", f, d.bytes, d.datenum);
+                else, fp = fp + f + "|missing;";
+                end
+            end
+        end
+
+        % folders needed to resolve the #include directives of a file,
+        % recursively, and the headers found there. Headers that cannot be
+        % found (e.g. provided by the compiler) are left to the compiler.
+        function [dirs, hdrs] = resolveIncludes(filename, source)
+            arguments
+                filename (1,1) string
+                source (1,1) string = "" % source text (if filename is "")
+            end
+            search = oclKernel.includeSearchPath();
+            dirs = string.empty;
+            hdrs = string.empty;
+            todo = filename;
+            while ~isempty(todo)
+                f = todo(1); todo(1) = [];
+                if f == "", txt = char(source); elseif oclKernel.isIL(f), continue; else, txt = fileread(f); end
+                tok = regexp(txt, '^\s*#\s*include\s*[<"]([^>"]+)[>"]', 'tokens', 'lineanchors');
+                tok = string([tok{:}]);
+                cand = search;
+                if f ~= "", cand = [string(fileparts(f)), cand]; end % the including file's folder first
+                for n = tok
+                    hit = find(isfile(fullfile(cand, n)), 1);
+                    if isempty(hit), continue; end
+                    h = string(fullfile(cand(hit), n));
+                    dirs(end+1) = cand(hit); %#ok<AGROW>
+                    if ~ismember(h, hdrs), hdrs(end+1) = h; todo(end+1) = h; end %#ok<AGROW>
+                end
+            end
+            dirs = unique(dirs, 'stable');
+        end
+
+        % folders searched for included headers: the (modified) path
+        function inc = includeSearchPath()
+            inc = string(split(path(), pathsep))';
+            inc = inc(~startsWith(inc, matlabroot));
+        end
+
+        % device profile options of a kernel or program, if enabled: an
+        % explicit -cl-std in its options takes precedence
+        function s = profileSettings(k)
+            s = string.empty;
+            if ~k.DeviceProfile || isempty(k.Device), return; end
+            s = profileOptions(k.Device);
+            if any(startsWith(k.opts, "-cl-std")), s(startsWith(s, "-cl-std")) = []; end
+        end
+
+        % in-memory LRU of the programs built for each set of build
+        % settings, so that switching back to earlier settings (e.g.
+        % macros) is a lookup rather than a rebuild
+        function v = noVariants()
+            v = struct('key', {}, 'id', {}, 'fp', {});
+        end
+
+        % handle of the variant built for key, if still current (else 0):
+        % it becomes the most recently used
+        function [v, h] = variantLookup(v, key, fp)
+            i = find([v.key] == key & [v.fp] == fp, 1);
+            if isempty(i), h = 0; return; end
+            h = v(i).id;
+            v = v([i, 1:i-1, i+1:end]);
+        end
+
+        % add (or replace) the variant built for key: returns the handles of
+        % the replaced variant and of the least recently used variants
+        % evicted beyond the capacity, each to be released once (handles
+        % are shared by every holder of the program in the launcher, which
+        % counts their references)
+        function [v, old] = variantInsert(v, key, h, fp, cap)
+            i = [v.key] == key;
+            rep = [v(i).id];
+            v(i) = [];
+            v = [struct('key', key, 'id', h, 'fp', fp), v];
+            cap = max(cap, 1); % the current build
+            old = [rep, v(cap+1:end).id];
+            v = v(1:min(end, cap));
+        end
+
+        % source with scalar arguments ind of kernel func compiled in as the
+        % constants vals: the parameters are renamed (but kept, so that the
+        % arguments are unchanged) and shadowed by a declaration of the same
+        % name at the start of the body
+        function src = specializeSource(src, func, ind, vals)
+            src = char(src);
+            i = regexp(src, "(__)?kernel\s+void\s+" + func + "\s*\(", 'end', 'once');
+            if isempty(i), error("oclKernel:kernelNotFound", "Cannot find the declaration of kernel " + func + "."); end
+
+            % parameter list (to the matching parenthesis) and body
+            d = 1; j = i;
+            while d > 0 && j < numel(src), j = j + 1; d = d + (src(j) == '(') - (src(j) == ')'); end
+            b = j + find(src(j+1:end) == '{', 1);
+            if d || isempty(b), error("oclKernel:kernelNotFound", "Cannot parse the declaration of kernel " + func + "."); end
+            prm = src(i+1:j-1);
+            cut = [0, find(prm == ',' & cumsum((prm == '(') - (prm == ')')) == 0), numel(prm)+1];
+            prm = arrayfun(@(k) prm(cut(k)+1:cut(k+1)-1), 1:numel(cut)-1, 'UniformOutput', false);
+
+            decl = '';
+            for k = 1:numel(ind)
+                tok = regexp(regexprep(prm{ind(k)}, '/\*.*?\*/|//[^\n]*', ' '), '^(.*?)(\w+)\s*$', 'tokens', 'once');
+                typ = strtrim(regexprep(tok{1}, '\<(__)?const\>', ''));
+                prm{ind(k)} = [tok{1}, tok{2}, '_specialized'];
+                decl = [decl, ' const ', typ, ' ', tok{2}, ' = ', vals{k}, ';']; %#ok<AGROW>
+            end
+            src = [src(1:i), strjoin(prm, ','), src(j:b), decl, src(b+1:end)]; % same line numbers
+        end
+
+        % exact OpenCL C literal of a numeric scalar
+        function s = literal(x)
+            switch class(x)
+                case "double", s = sprintf('%.17e', x);
+                case "single", s = sprintf('%.9ef', x);
+                case "uint64", s = sprintf('%dUL', x);
+                case "int64"
+                    if x == intmin('int64'), s = '(-9223372036854775807L-1)'; % no literal for it
+                    else, s = sprintf('%dL', x);
+                    end
+                case "uint32", s = sprintf('%dU', x);
+                otherwise    , s = sprintf('%d', x);
+            end
+        end
+
+        % start a (background) build in the launcher: source text is
+        % compiled from memory, and deduplicated by its content
+        function h = startBuild(dev, filename, source, opts, headers, specs)
+            arguments
+                dev, filename, source, opts, headers
+                specs (:,2) cell = cell(0,2) % SPIR-V specialization constants
+            end
+            if oclKernel.isIL(filename)
+                h = cl_launcher('build_il', double(dev), char(filename), char(opts), char(oclKernel.programCache()), true, {}, ...
+                    cellfun(@double, specs(:,1)), specs(:,2));
+            elseif filename == ""
+                h = cl_launcher('build_source', double(dev), char(source), char(opts), char(oclKernel.programCache()), true, cellstr(headers));
+            else
+                h = cl_launcher('build', double(dev), char(filename), char(opts), char(oclKernel.programCache()), true, cellstr(headers));
+            end
+        end
+
+        % whether a file is a SPIR-V module
+        function tf = isIL(filename)
+            tf = endsWith(lower(filename), [".spv", ".spirv"]);
+        end
+
+        % build key of specialization constants
+        function s = specKey(specs)
+            s = "";
+            for i = 1:size(specs, 1)
+                s = s + "|" + specs{i,1} + "=" + class(specs{i,2}) + ":" + oclKernel.literal(specs{i,2});
+            end
+        end
+
+        % kernel names and (OpenCL C) signatures of a SPIR-V module: from
+        % its entry points, their parameters and the parameter types
+        function [names, sigs] = parseSpirv(filename)
+            fid = fopen(filename, 'r', 'l');
+            if fid < 0, error("oclKernel:fileNotFound", "Unable to read " + filename + "."); end
+            w = fread(fid, Inf, '*uint32')'; fclose(fid);
+            if numel(w) > 5 && swapbytes(w(1)) == 0x07230203, w = swapbytes(w); end % big-endian
+            if numel(w) < 5 || w(1) ~= 0x07230203, error("oclKernel:invalidIL", filename + " is not a SPIR-V module."); end
+
+            % literal string of words
+            lit = @(v) string(strtok(char(typecast(v, 'uint8')), char(0)));
+            ints = ["char", "short", "int", "long"]; % 8 to 64 bits (signedness is not recorded)
+            flts = ["half", "float", "double"]; % 16 to 64 bits
+            sc = ["constant", "", "", "", "local", "global", "private", "private", ""]; % storage classes 0 to 8
+
+            T = repmat("void", [1, double(w(4))]); % type (or param) name by id - 1
+            nm = strings(1, double(w(4))); % debug names
+            ro = false(1, double(w(4))); % FuncParamAttr NoWrite
+            ep = zeros(1,0); names = strings(1,0); % entry points
+            prm = zeros(0,2); % [function, parameter] ids
+            fn = 0; % current function
+            i = 6;
+            while i <= numel(w)
+                op = bitand(w(i), 65535); n = double(bitshift(w(i), -16));
+                if n < 1 || i + n - 1 > numel(w), error("oclKernel:invalidIL", filename + " is not a valid SPIR-V module."); end
+                a = double(w(i+1:i+n-1)) + 1; % ids (1-based) or literals + 1
+                switch op
+                    case 5 , nm(a(1)) = lit(w(i+2:i+n-1)); % OpName
+                    case 15, ep(end+1) = a(2); names(end+1) = lit(w(i+3:i+n-1)); %#ok<AGROW> OpEntryPoint
+                    case 20, T(a(1)) = "bool"; % OpTypeBool
+                    case 21, T(a(1)) = ints(log2((a(2)-1)/8) + 1); % OpTypeInt
+                    case 22, T(a(1)) = flts(log2((a(2)-1)/16) + 1); % OpTypeFloat
+                    case 23, T(a(1)) = T(a(2)) + (a(3)-1); % OpTypeVector
+                    case 32, T(a(1)) = strip(sc(min(a(2), 9)) + " " + T(a(3)) + " *"); % OpTypePointer
+                    case 54, fn = a(2); % OpFunction
+                    case 55, prm(end+1,:) = [fn, a(2)]; T(a(2)) = T(a(1)); %#ok<AGROW> OpFunctionParameter
+                    case 71, if n > 3 && a(2) == 39 && a(3) == 7, ro(a(1)) = true; end % OpDecorate FuncParamAttr NoWrite
+                end
+                i = i + n;
+            end
+
+            % signatures
+            sigs = strings(size(names));
+            for k = 1:numel(ep)
+                p = prm(prm(:,1) == ep(k), 2)';
+                nms = nm(p); nms(nms == "") = "arg" + find(nms == "");
+                typ = T(p); typ(ro(p)) = "const " + typ(ro(p));
+                sigs(k) = "kernel void " + names(k) + "(" + strjoin(cellstr(typ + " " + nms), ", ") + ")";
+            end
+        end
+
+        % description of a source for messages
+        function s = sourceLabel(filename)
+            if filename == "", s = "the source text"; else, s = "file " + filename; end
+        end
+
+        % parse the kernel names and signatures from a file or source text
+        function [filename, names, sigs, source] = parseSource(SRC)
+            arguments, SRC string, end
+
+            % if this is a file we can find
+            if isscalar(SRC) && exist(SRC, 'file')
+                filename = which(SRC); % file we can find
+                if isempty(filename), filename = SRC; end
+                filename = string(filename); % get full path
+                source = "";
+                cl = filename;
+                if oclKernel.isIL(filename) % signatures from the OpenCL C source, or the module
+                    cl = regexprep(filename, '\.[^.]*$', '.cl');
+                    if ~isfile(cl), [names, sigs] = oclKernel.parseSpirv(filename); return; end
+                end
+            else % source text - kept in memory
+                filename = "";
+                source = join(SRC(:), newline);
+            end
+
+            % scan in one pass with the native scanner (if compiled): it
+            % also skips preprocessor lines and attributes with arguments
+            if exist('cl_scan_source', 'file') == 3
+                if filename == "", [names, sigs] = cl_scan_source(char(source), false);
+                else,              [names, sigs] = cl_scan_source(char(cl), true);
+                end
+                names = reshape(string(names), 1, []);
+                sigs  = reshape(string(sigs ), 1, []);
+                return;
+            end
+            if filename == "", lns = splitlines(source); else, lns = readlines(cl); end
+
+            % parse code
+            cod = lns;
+            i = contains(lns,"//");
+            cod(i) = arrayfun(@(l) extractBefore(l, "//"), cod(i)); % remove C line comments
+            cod(startsWith(cod, "#")) = []; % delete lines starting with '#'
+            cod = join(cod,'\n');
+            cod = eraseBetween(cod,"/*","*/",'Boundaries','inclusive'); % remove C block comments
+            cod = string(split(cod, '\n'));
+            % cod = join(cod); % combine with spaces
+
+            % CL kernel pattern
+            fnm = asManyOfPattern(alphanumericsPattern | "_", 1);
+            pat = "kernel void" + whitespacePattern + fnm + "(" ...
+            + (asManyOfPattern(alphanumericsPattern|whitespacePattern|","|"*"|"_"|"["|"]")) ...
+            + lookAheadBoundary(")");
+
+            % get the kernel function signatures and names
+            sigs  = reshape(extract(join(cod), pat), 1, []); % signature lines
+            names = strip(extractBetween(sigs, "kernel void", "(")); % function names
+        end
+
+        % folder of the on-disk program binary cache ("" if unavailable)
+        % set the environment variable MATLAB_OPENCL_PROGRAM_CACHE to "off"
+        % to disable it
+        function fld = programCache()
+            persistent fld_;
+            if isempty(fld_)
+                fld_ = fullfile(oclDevice.cacheFolder(), "programs");
+                try if ~isfolder(fld_), mkdir(fld_); end
+                catch, fld_ = ""; % read-only or unavailable
+                end
+            end
+            fld = fld_;
+            if lower(getenv("MATLAB_OPENCL_PROGRAM_CACHE")) == "off", fld = ""; end
+        end
+    end
 end
 
 %% Helpers
@@ -0,0 +1,57 @@
+function T = oclPlatformTable(props)
+% OCLPLATFORMTABLE - Table of properties of detected OpenCL platforms
+% 
+% T = OCLPLATFORMTABLE returns a table indicating the index, name,
+% version, and other properties of each OpenCL platform detected in your
+% system, as well as the indices of the devices on each platform. Devices
+% on the same platform can share an OpenCL context.
+%
+% T = OCLPLATFORMTABLE(PROPS) returns an OpenCL platform table with the
+% platform properties specified by PROPS as table variables. PROPS must be
+% a string array or a cell array of character vectors where each entry is
+% an OpenCL platform query e.g. "CL_PLATFORM_NAME".
+% 
+% % Example: Group GPUs by platform
+% [~, igpu] = oclDeviceCount("gpu");
+% T = oclPlatformTable();
+% T.Devices = cellfun(@(i) intersect(i, igpu), T.Devices, 'UniformOutput', false);
+% disp(T(:, ["Index", "Name", "Devices"]));
+%
+% See also oclDeviceTable, oclDeviceCount, oclDevice
+
+arguments
+    props (1,:) string {mustBeMember(props, ["CL_PLATFORM_NAME","CL_PLATFORM_VENDOR","CL_PLATFORM_VERSION","CL_PLATFORM_PROFILE","CL_PLATFORM_EXTENSIONS"])} ...
+        = "CL_PLATFORM_" + ["NAME", "VENDOR", "VERSION", "PROFILE", "EXTENSIONS"]
+end
+
+% each property is queried once
+props = unique(props, 'stable');
+
+% query typed columns (one row per platform) and each device's platform
+if ~exist('cl_get_device_info','file') || parallel.internal.pool.isPoolThreadWorker
+    S = cell2struct(repmat({zeros(0,1)}, [numel(props),1]), cellstr(props), 1);
+    P = zeros(0,1);
+else
+    S = cl_get_device_info(cellstr(props), 'platforms');
+    D = cl_get_device_info({'CL_DEVICE_PLATFORM'}, 'columns');
+    P = D.CL_DEVICE_PLATFORM;
+end
+
+% turn CL_PLATFORM_SNAKE_CASE into PascalCase
+flds = regexprep(lower(extractAfter(props, "CL_PLATFORM_")), "(?:^|_)(.)", "${upper($1)}");
+
+% format
+T = struct2table(S);
+T.Properties.VariableNames = cellstr(flds);
+
+% get number of platforms
+N = height(T);
+
+% prepend index, append the platform -> device mapping
+T = addvars(T, (1:N)', 'Before', 1, 'NewVariableNames', "Index");
+T.Devices = arrayfun(@(i) {find(P == i)'}, T.Index);
+
+% parse the extensions for convenience
+if any(contains(string(T.Properties.VariableNames), "Extensions"))
+    T.Extensions = arrayfun(@(s) {unique(split(s," ",2),'stable')}, T.Extensions);
+end
@@ -0,0 +1,203 @@
+classdef oclProgram < handle
+    properties(SetAccess=protected)
+        filename string % program filename ("" for source text)
+        KernelNames (1,:) string = string.empty % OpenCL C kernel functions
+    end
+    properties(SetAccess=protected, Dependent)
+        built (1,1) logical % whether the program has been built for these settings
+    end
+    properties
+        Device oclDevice {mustBeScalarOrEmpty} = oclDevice() % oclDevice for build
+    end
+    properties
+        macros (1,:) string = string.empty % macros - will be prepended with '-D' when building
+        include (1,:) string = string.empty % includes - will be prepended with '-I' when building
+        opts (1,:) string = "-cl-" + ["mad-enable", "fp32-correctly-rounded-divide-sqrt"] % options passed to the OpenCL C compiler
+        MaxVariants (1,1) double {mustBeInteger, mustBeNonnegative} = 8 % number of build settings kept built (most recently used)
+        DeviceProfile (1,1) logical = false % define the device's capabilities as macros and use its highest -cl-std (see oclDevice/profileOptions)
+        SpecConstants (:,2) cell = cell(0,2) % {SpecId, value} pairs for a SPIR-V module - the class of a value sets its size, e.g. uint32(64)
+    end
+    properties(Hidden,SetAccess=protected)
+        signatures (1,:) string = string.empty % C declaration signature per kernel
+        build_settings (1,1) string % cached compiler options string
+        built_dev_ind (1,1) double % device index on (last) build
+        built_stgs (1,:) string % device settings on (last) build
+        built_opts (1,1) string = "" % compiler options on (last) build, with any further settings
+        built_specs (:,2) cell = cell(0,2) % specialization constants on (last) build
+        prog_id (1,1) double = 0 % cl_launcher program handle on (last) build
+        headers (1,:) string = string.empty % headers included by the source (resolved)
+        source (1,1) string = "" % source text (if not from a file)
+        parsed_fp (1,1) string % fingerprint of the source and headers when parsed
+        built_fp (1,1) string % fingerprint of the source and headers on (last) build
+    end
+    properties(Hidden,SetAccess={?oclProgram,?oclKernel})
+        variants (1,:) struct = oclKernel.noVariants() % built settings (key), handle (id) and fingerprint (fp) - most recent first
+    end
+
+    methods
+        function prog = oclProgram(SRC, kwargs)
+            % oclProgram OpenCL Program object
+            %
+            % prog = oclProgram(CL) returns a program object for all of the
+            % kernels in CL, where CL is either the name of the file that
+            % contains the CL code, or the contents of a CL file as a
+            % character vector. The program is parsed once and built once
+            % for all of its kernels.
+            %
+            % Example:
+            % prog = oclProgram('filters.cl');
+            % prog.macros = "WIDTH=" + 512;
+            % [kx, ky] = deal(prog.kernel("sobel_x"), prog.kernel("sobel_y"));
+            % y = feval(kx, x); % builds the program (once)
+            %
+            % CL may also name a SPIR-V module (.spv or .spirv): see
+            % oclKernel.
+            %
+            % prog = oclProgram(CL, "BuildAsync", true) starts building the
+            % program in the background.
+            %
+            % Kernels of a program share its Device and build settings:
+            % changing either on the program or on any of its kernels
+            % requires one rebuild, after which every kernel uses the new
+            % program.
+            %
+            % See also oclKernel
+            arguments
+                SRC string % source code
+                kwargs.BuildAsync (1,1) logical = false % start building in the background
+            end
+
+            [prog.filename, prog.KernelNames, prog.signatures, prog.source] = oclKernel.parseSource(SRC);
+            if isempty(prog.KernelNames)
+                error("oclProgram:invalidProgram", "Cannot find any kernels in " + oclKernel.sourceLabel(prog.filename) + ".");
+            end
+
+            % include only the folders of the headers used
+            [inc, prog.headers] = oclKernel.resolveIncludes(prog.filename, prog.source);
+            prog.parsed_fp = oclKernel.fingerprint([prog.filename, prog.headers]);
+
+            prog.Device  = oclDevice();
+            prog.include = inc; % default
+
+            % start building: kernels wait for the build if needed
+            if kwargs.BuildAsync, build(prog, string.empty, "wait", false); end
+        end
+
+        function kern = kernel(prog, FUNC)
+            %KERNEL - Kernel objects sharing the program
+            % kern = kernel(PROG, FUNC) returns an oclKernel for the kernel
+            % named FUNC. If FUNC is a string array, kern is an array of
+            % the corresponding kernels. If FUNC is omitted, kern contains
+            % every kernel in the program.
+            %
+            % See also oclKernel
+            arguments
+                prog (1,1) oclProgram
+                FUNC (1,:) string = prog.KernelNames
+            end
+            kern = arrayfun(@(f) oclKernel(prog, f), FUNC);
+        end
+
+        function prog = build(prog, stgs, kwargs)
+            %BUILD - Build the program
+            % build(PROG) builds the program for its Device.
+            %
+            % build(PROG, STGS) appends the compiler options STGS.
+            %
+            % build(..., "wait", false) returns while the program is
+            % compiling. See also oclProgram/wait.
+            %
+            % build also picks up edits of the source file or its headers,
+            % which launches do not check for: call build after an edit.
+            arguments
+                prog (1,1) oclProgram
+                stgs (1,:) string = string.empty % further settings
+                kwargs.wait (1,1) logical = true % wait for the build to complete
+            end
+
+            % match the launcher's devices to the device table
+            oclDevice.partitionSync("cl_launcher");
+
+            % pick up edits of the source or its headers
+            fp = oclKernel.fingerprint([prog.filename, prog.headers]);
+            if fp ~= prog.parsed_fp, reparse(prog); fp = prog.parsed_fp; end
+
+            % get compilation settings (with build first)
+            s = [prog.build_settings, stgs];
+
+            % switch to a resident variant, or compile one: the program
+            % stays resident in the launcher until evicted
+            key = prog.Device.Index + "|" + join(s) + oclKernel.specKey(prog.SpecConstants);
+            [prog.variants, h] = oclKernel.variantLookup(prog.variants, key, fp);
+            if ~h
+                h = oclKernel.startBuild(prog.Device.Index, prog.filename, prog.source, join(s), prog.headers, prog.SpecConstants);
+                [prog.variants, old] = oclKernel.variantInsert(prog.variants, key, h, fp, prog.MaxVariants);
+                for o = old, cl_launcher('release', o); end
+            end
+            prog.prog_id = h;
+
+            % save build settings
+            prog.built_dev_ind = prog.Device.Index;
+            prog.built_stgs    = prog.build_settings;
+            prog.built_opts    = join(s);
+            prog.built_specs   = prog.SpecConstants;
+            prog.built_fp      = fp;
+            if kwargs.wait, wait(prog); end
+        end
+
+        function prog = wait(prog)
+            %WAIT - Wait for the program to finish building
+            arguments, prog (1,1) oclProgram, end
+            try
+                okn = string(cl_launcher('wait', prog.prog_id));
+            catch ME
+                prog.built_dev_ind = 0; % not built
+                prog.variants([prog.variants.id] == prog.prog_id) = [];
+                rethrow(ME);
+            end
+
+            % ensure that every kernel was included
+            if ~all(ismember(prog.KernelNames, okn))
+                error( ...
+                    "oclProgram:kernelNotFound", "Expected to find kernels {" + join(prog.KernelNames, ", ") + ...
+                    "} but instead the kernels found were {" + join(okn, ", ") + "}." ...
+                    );
+            end
+        end
+
+        function release(prog)
+            %RELEASE - Release the built programs
+            % release(PROG) releases the programs built for PROG, including
+            % those kept for other build settings (see MaxVariants). The
+            % program is rebuilt when one of its kernels is next launched.
+            arguments, prog (1,1) oclProgram, end
+            for h = [prog.variants.id], cl_launcher('release', h); end
+            prog.variants = oclKernel.noVariants();
+            prog.built_dev_ind = 0; % not built
+        end
+
+        function tf = get.built(prog)
+            tf = isequal(prog.Device.Index, prog.built_dev_ind) && isequal(prog.build_settings, prog.built_stgs) ...
+                && isequal(prog.SpecConstants, prog.built_specs); % files are checked by build (no I/O per launch)
+        end
+        function s = get.build_settings(prog)
+            s = join([
+                "-I" + prog.include, ...
+                "-D" + prog.macros , ...
+                       prog.opts   , ...
+                       oclKernel.profileSettings(prog) ...
+                ]);
+        end
+    end
+
+    methods(Access=protected)
+        % re-parse an edited source: kernels and headers
+        function reparse(prog)
+            if prog.filename == "", src = prog.source; else, src = prog.filename; end
+            [~, prog.KernelNames, prog.signatures] = oclKernel.parseSource(src);
+            [inc, prog.headers] = oclKernel.resolveIncludes(prog.filename, prog.source);
+            prog.include = unique([prog.include, inc], 'stable'); % add any new folders
+            prog.parsed_fp = oclKernel.fingerprint([prog.filename, prog.headers]);
+        end
+    end
+end
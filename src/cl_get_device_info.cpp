@@ -6,9 +6,15 @@
 #include "mex.h"
 #include "tmwtypes.h"
 #include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <thread>
 
-#include "ocl_dev_mgr.hpp" // use the same settings as in the MatCL dependency
-#include <CL/cl.h>
+#include "ocl_device_list.hpp" // device cache (shared with cl_launcher)
+#include "ocl_device_version.hpp" // deviceVersion
 
 #define PTYPE_BOOL 1 
 #define PTYPE_CHAR 2 
@@ -16,34 +22,691 @@
 #define PTYPE_ULNG 4 
 #define PTYPE_SIZT 5 
 #define PTYPE_SZTA 6 
-// not yet supported
-#define PTYPE_PLFM 0 
+#define PTYPE_PLFM 7 
 #define PTYPE_DEVC 8 
+#define PTYPE_PCHR 9 // platform property
+#define PTYPE_BITF 10 // bitfield
+#define PTYPE_VERS 11 // cl_version
+#define PTYPE_NVER 12 // cl_name_version array
+#define PTYPE_PCIA 13 // PCI address "dddd:bb:dd.f"
+#define PTYPE_UUID 14 // 16 byte UUID
+#define PTYPE_NUMA 15 // NUMA node of the PCI device (-1 if unknown)
+#define PTYPE_DKEY 16 // stable device key
+#define PTYPE_AVMM 17 // free global memory in bytes (vendor extensions only - NaN if unknown)
+#define PTYPE_PRNT 18 // parent device index (0 for root devices)
 
+// OpenCL 2.x/3.0 queries are not declared by the (v1.2) header: they are
+// only requested from devices reporting a sufficient CL_DEVICE_VERSION
+#ifndef CL_DEVICE_MAX_READ_WRITE_IMAGE_ARGS
+#define CL_DEVICE_MAX_READ_WRITE_IMAGE_ARGS               0x104C
+#define CL_DEVICE_MAX_GLOBAL_VARIABLE_SIZE                0x104D
+#define CL_DEVICE_QUEUE_ON_DEVICE_PROPERTIES              0x104E
+#define CL_DEVICE_QUEUE_ON_DEVICE_PREFERRED_SIZE          0x104F
+#define CL_DEVICE_QUEUE_ON_DEVICE_MAX_SIZE                0x1050
+#define CL_DEVICE_MAX_ON_DEVICE_QUEUES                    0x1051
+#define CL_DEVICE_MAX_ON_DEVICE_EVENTS                    0x1052
+#define CL_DEVICE_SVM_CAPABILITIES                        0x1053
+#define CL_DEVICE_GLOBAL_VARIABLE_PREFERRED_TOTAL_SIZE    0x1054
+#define CL_DEVICE_MAX_PIPE_ARGS                           0x1055
+#define CL_DEVICE_PIPE_MAX_ACTIVE_RESERVATIONS            0x1056
+#define CL_DEVICE_PIPE_MAX_PACKET_SIZE                    0x1057
+#define CL_DEVICE_PREFERRED_PLATFORM_ATOMIC_ALIGNMENT     0x1058
+#define CL_DEVICE_PREFERRED_GLOBAL_ATOMIC_ALIGNMENT       0x1059
+#define CL_DEVICE_PREFERRED_LOCAL_ATOMIC_ALIGNMENT        0x105A
+#endif
+#ifndef CL_DEVICE_IL_VERSION
+#define CL_DEVICE_IL_VERSION                              0x105B
+#define CL_DEVICE_MAX_NUM_SUB_GROUPS                      0x105C
+#define CL_DEVICE_SUB_GROUP_INDEPENDENT_FORWARD_PROGRESS  0x105D
+#endif
+#ifndef CL_DEVICE_NUMERIC_VERSION
+#define CL_DEVICE_NUMERIC_VERSION                         0x105E
+#define CL_DEVICE_EXTENSIONS_WITH_VERSION                 0x1060
+#define CL_DEVICE_ILS_WITH_VERSION                        0x1061
+#define CL_DEVICE_BUILT_IN_KERNELS_WITH_VERSION           0x1062
+#define CL_DEVICE_ATOMIC_MEMORY_CAPABILITIES              0x1063
+#define CL_DEVICE_ATOMIC_FENCE_CAPABILITIES               0x1064
+#define CL_DEVICE_NON_UNIFORM_WORK_GROUP_SUPPORT          0x1065
+#define CL_DEVICE_OPENCL_C_ALL_VERSIONS                   0x1066
+#define CL_DEVICE_PREFERRED_WORK_GROUP_SIZE_MULTIPLE      0x1067
+#define CL_DEVICE_WORK_GROUP_COLLECTIVE_FUNCTIONS_SUPPORT 0x1068
+#define CL_DEVICE_GENERIC_ADDRESS_SPACE_SUPPORT           0x1069
+#define CL_DEVICE_OPENCL_C_FEATURES                       0x106F
+#define CL_DEVICE_DEVICE_ENQUEUE_CAPABILITIES             0x1070
+#define CL_DEVICE_PIPE_SUPPORT                            0x1071
+#define CL_DEVICE_LATEST_CONFORMANCE_VERSION_PASSED       0x1072
+#endif
+#ifndef CL_DEVICE_SUB_GROUP_SIZES_INTEL
+#define CL_DEVICE_SUB_GROUP_SIZES_INTEL                   0x4108 // cl_intel_required_subgroup_size
+#endif
 
-std::vector<cl::Device> getOclDevices(){
+// topology extensions
+#ifndef CL_DEVICE_PCI_BUS_INFO_KHR
+#define CL_DEVICE_PCI_BUS_INFO_KHR                        0x410F // cl_khr_pci_bus_info
+#endif
+#ifndef CL_DEVICE_TOPOLOGY_AMD
+#define CL_DEVICE_TOPOLOGY_AMD                            0x4037 // cl_amd_device_attribute_query
+#define CL_DEVICE_TOPOLOGY_TYPE_PCIE_AMD                  1
+#endif
+#ifndef CL_DEVICE_GLOBAL_FREE_MEMORY_AMD
+#define CL_DEVICE_GLOBAL_FREE_MEMORY_AMD                  0x4039 // cl_amd_device_attribute_query
+#endif
+#ifndef CL_DEVICE_PCI_BUS_ID_NV
+#define CL_DEVICE_PCI_BUS_ID_NV                           0x4008 // cl_nv_device_attribute_query
+#define CL_DEVICE_PCI_SLOT_ID_NV                          0x4009
+#define CL_DEVICE_PCI_DOMAIN_ID_NV                        0x400A
+#endif
+#ifndef CL_DEVICE_UUID_KHR
+#define CL_DEVICE_UUID_KHR                                0x106A // cl_khr_device_uuid
+#define CL_DRIVER_UUID_KHR                                0x106B
+#endif
 
-  // Variables
-  std::vector<cl::Device> devs, tmp; // devices
-  std::vector<cl::Platform> platforms; // platforms
+// cl_device_pci_bus_info_khr
+struct PciBusInfoKhr {
+  cl_uint domain, bus, device, function;
+};
 
-  // get devices per platform devices
-  cl::Platform::get(&platforms); // all platforms
-  for (cl::Platform const& p : platforms){ // for each platform
-    p.getDevices(CL_DEVICE_TYPE_ALL, &tmp);
-    devs.insert(devs.end(), tmp.begin(), tmp.end());
+// cl_device_topology_amd
+union TopologyAmd {
+  struct { cl_uint type; cl_uint data[5]; } raw;
+  struct { cl_uint type; unsigned char unused[17]; unsigned char bus, device, function; } pcie;
+};
+
+// cl_name_version (v3.0)
+struct NameVersion {
+  cl_uint version; // cl_version: major (10b) | minor (10b) | patch (12b)
+  char name[64];
+};
+
+
+// property look-up table: name -> (id, type)
+// N.B. entries must remain sorted by name (in byte order) for binary search
+struct PropInfo {
+  const char * name; // property name
+  cl_device_info id; // OpenCL enumeration (cl_platform_info for PTYPE_PCHR)
+  char type; // PTYPE_*
+  unsigned short version; // minimum device OpenCL version (e.g. 210 for 2.1), or 0
+  const char * ext; // required device extension, or NULL
+};
+
+constexpr PropInfo OCL_PROPS[] = {
+  {"CL_DEVICE_ADDRESS_BITS"                           , CL_DEVICE_ADDRESS_BITS                           , PTYPE_UINT,   0, NULL},
+  {"CL_DEVICE_ATOMIC_FENCE_CAPABILITIES"              , CL_DEVICE_ATOMIC_FENCE_CAPABILITIES              , PTYPE_BITF, 300, NULL},
+  {"CL_DEVICE_ATOMIC_MEMORY_CAPABILITIES"             , CL_DEVICE_ATOMIC_MEMORY_CAPABILITIES             , PTYPE_BITF, 300, NULL},
+  {"CL_DEVICE_AVAILABLE"                              , CL_DEVICE_AVAILABLE                              , PTYPE_BOOL,   0, NULL},
+  {"CL_DEVICE_AVAILABLE_MEMORY"                       , 0                                                , PTYPE_AVMM,   0, NULL},
+  {"CL_DEVICE_BUILT_IN_KERNELS"                       , CL_DEVICE_BUILT_IN_KERNELS                       , PTYPE_CHAR, 120, NULL},
+  {"CL_DEVICE_BUILT_IN_KERNELS_WITH_VERSION"          , CL_DEVICE_BUILT_IN_KERNELS_WITH_VERSION          , PTYPE_NVER, 300, NULL},
+  {"CL_DEVICE_COMPILER_AVAILABLE"                     , CL_DEVICE_COMPILER_AVAILABLE                     , PTYPE_BOOL,   0, NULL},
+  {"CL_DEVICE_DEVICE_ENQUEUE_CAPABILITIES"            , CL_DEVICE_DEVICE_ENQUEUE_CAPABILITIES            , PTYPE_BITF, 300, NULL},
+  {"CL_DEVICE_EXTENSIONS"                             , CL_DEVICE_EXTENSIONS                             , PTYPE_CHAR,   0, NULL},
+  {"CL_DEVICE_EXTENSIONS_WITH_VERSION"                , CL_DEVICE_EXTENSIONS_WITH_VERSION                , PTYPE_NVER, 300, NULL},
+  {"CL_DEVICE_GENERIC_ADDRESS_SPACE_SUPPORT"          , CL_DEVICE_GENERIC_ADDRESS_SPACE_SUPPORT          , PTYPE_BOOL, 300, NULL},
+  {"CL_DEVICE_GLOBAL_FREE_MEMORY_AMD"                 , CL_DEVICE_GLOBAL_FREE_MEMORY_AMD                 , PTYPE_SZTA,   0, "cl_amd_device_attribute_query"},
+  {"CL_DEVICE_GLOBAL_MEM_CACHELINE_SIZE"              , CL_DEVICE_GLOBAL_MEM_CACHELINE_SIZE              , PTYPE_UINT,   0, NULL},
+  {"CL_DEVICE_GLOBAL_MEM_CACHE_SIZE"                  , CL_DEVICE_GLOBAL_MEM_CACHE_SIZE                  , PTYPE_ULNG,   0, NULL},
+  {"CL_DEVICE_GLOBAL_MEM_SIZE"                        , CL_DEVICE_GLOBAL_MEM_SIZE                        , PTYPE_ULNG,   0, NULL},
+  {"CL_DEVICE_GLOBAL_VARIABLE_PREFERRED_TOTAL_SIZE"   , CL_DEVICE_GLOBAL_VARIABLE_PREFERRED_TOTAL_SIZE   , PTYPE_SIZT, 200, NULL},
+  {"CL_DEVICE_ILS_WITH_VERSION"                       , CL_DEVICE_ILS_WITH_VERSION                       , PTYPE_NVER, 300, NULL},
+  {"CL_DEVICE_IL_VERSION"                             , CL_DEVICE_IL_VERSION                             , PTYPE_CHAR, 210, NULL},
+  {"CL_DEVICE_LATEST_CONFORMANCE_VERSION_PASSED"      , CL_DEVICE_LATEST_CONFORMANCE_VERSION_PASSED      , PTYPE_CHAR, 300, NULL},
+  {"CL_DEVICE_LINKER_AVAILABLE"                       , CL_DEVICE_LINKER_AVAILABLE                       , PTYPE_BOOL, 120, NULL},
+  {"CL_DEVICE_LOCAL_MEM_SIZE"                         , CL_DEVICE_LOCAL_MEM_SIZE                         , PTYPE_ULNG,   0, NULL},
+  {"CL_DEVICE_MAX_CLOCK_FREQUENCY"                    , CL_DEVICE_MAX_CLOCK_FREQUENCY                    , PTYPE_UINT,   0, NULL},
+  {"CL_DEVICE_MAX_COMPUTE_UNITS"                      , CL_DEVICE_MAX_COMPUTE_UNITS                      , PTYPE_UINT,   0, NULL},
+  {"CL_DEVICE_MAX_CONSTANT_ARGS"                      , CL_DEVICE_MAX_CONSTANT_ARGS                      , PTYPE_UINT,   0, NULL},
+  {"CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE"               , CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE               , PTYPE_ULNG,   0, NULL},
+  {"CL_DEVICE_MAX_GLOBAL_VARIABLE_SIZE"               , CL_DEVICE_MAX_GLOBAL_VARIABLE_SIZE               , PTYPE_SIZT, 200, NULL},
+  {"CL_DEVICE_MAX_MEM_ALLOC_SIZE"                     , CL_DEVICE_MAX_MEM_ALLOC_SIZE                     , PTYPE_ULNG,   0, NULL},
+  {"CL_DEVICE_MAX_NUM_SUB_GROUPS"                     , CL_DEVICE_MAX_NUM_SUB_GROUPS                     , PTYPE_UINT, 210, NULL},
+  {"CL_DEVICE_MAX_ON_DEVICE_EVENTS"                   , CL_DEVICE_MAX_ON_DEVICE_EVENTS                   , PTYPE_UINT, 200, NULL},
+  {"CL_DEVICE_MAX_ON_DEVICE_QUEUES"                   , CL_DEVICE_MAX_ON_DEVICE_QUEUES                   , PTYPE_UINT, 200, NULL},
+  {"CL_DEVICE_MAX_PARAMETER_SIZE"                     , CL_DEVICE_MAX_PARAMETER_SIZE                     , PTYPE_ULNG,   0, NULL},
+  {"CL_DEVICE_MAX_PIPE_ARGS"                          , CL_DEVICE_MAX_PIPE_ARGS                          , PTYPE_UINT, 200, NULL},
+  {"CL_DEVICE_MAX_READ_WRITE_IMAGE_ARGS"              , CL_DEVICE_MAX_READ_WRITE_IMAGE_ARGS              , PTYPE_UINT, 200, NULL},
+  {"CL_DEVICE_MAX_WORK_GROUP_SIZE"                    , CL_DEVICE_MAX_WORK_GROUP_SIZE                    , PTYPE_SIZT,   0, NULL},
+  {"CL_DEVICE_MAX_WORK_ITEM_DIMENSIONS"               , CL_DEVICE_MAX_WORK_ITEM_DIMENSIONS               , PTYPE_UINT,   0, NULL},
+  {"CL_DEVICE_MAX_WORK_ITEM_SIZES"                    , CL_DEVICE_MAX_WORK_ITEM_SIZES                    , PTYPE_SZTA,   0, NULL},
+  {"CL_DEVICE_NAME"                                   , CL_DEVICE_NAME                                   , PTYPE_CHAR,   0, NULL},
+  {"CL_DEVICE_NON_UNIFORM_WORK_GROUP_SUPPORT"         , CL_DEVICE_NON_UNIFORM_WORK_GROUP_SUPPORT         , PTYPE_BOOL, 300, NULL},
+  {"CL_DEVICE_NUMA_NODE"                              , 0                                                , PTYPE_NUMA,   0, NULL},
+  {"CL_DEVICE_NUMERIC_VERSION"                        , CL_DEVICE_NUMERIC_VERSION                        , PTYPE_VERS, 300, NULL},
+  {"CL_DEVICE_OPENCL_C_ALL_VERSIONS"                  , CL_DEVICE_OPENCL_C_ALL_VERSIONS                  , PTYPE_NVER, 300, NULL},
+  {"CL_DEVICE_OPENCL_C_FEATURES"                      , CL_DEVICE_OPENCL_C_FEATURES                      , PTYPE_NVER, 300, NULL},
+  {"CL_DEVICE_OPENCL_C_VERSION"                       , CL_DEVICE_OPENCL_C_VERSION                       , PTYPE_CHAR, 110, NULL},
+  {"CL_DEVICE_PARENT_DEVICE"                          , CL_DEVICE_PARENT_DEVICE                          , PTYPE_PRNT, 120, NULL},
+  {"CL_DEVICE_PARTITION_AFFINITY_DOMAIN"              , CL_DEVICE_PARTITION_AFFINITY_DOMAIN              , PTYPE_BITF, 120, NULL},
+  {"CL_DEVICE_PARTITION_MAX_SUB_DEVICES"              , CL_DEVICE_PARTITION_MAX_SUB_DEVICES              , PTYPE_UINT, 120, NULL},
+  {"CL_DEVICE_PCI_ADDRESS"                            , 0                                                , PTYPE_PCIA,   0, NULL},
+  {"CL_DEVICE_PCI_BUS_ID_NV"                          , CL_DEVICE_PCI_BUS_ID_NV                          , PTYPE_UINT,   0, "cl_nv_device_attribute_query"},
+  {"CL_DEVICE_PCI_BUS_INFO_KHR"                       , CL_DEVICE_PCI_BUS_INFO_KHR                       , PTYPE_PCIA,   0, "cl_khr_pci_bus_info"},
+  {"CL_DEVICE_PCI_DOMAIN_ID_NV"                       , CL_DEVICE_PCI_DOMAIN_ID_NV                       , PTYPE_UINT,   0, "cl_nv_device_attribute_query"},
+  {"CL_DEVICE_PCI_SLOT_ID_NV"                         , CL_DEVICE_PCI_SLOT_ID_NV                         , PTYPE_UINT,   0, "cl_nv_device_attribute_query"},
+  {"CL_DEVICE_PIPE_MAX_ACTIVE_RESERVATIONS"           , CL_DEVICE_PIPE_MAX_ACTIVE_RESERVATIONS           , PTYPE_UINT, 200, NULL},
+  {"CL_DEVICE_PIPE_MAX_PACKET_SIZE"                   , CL_DEVICE_PIPE_MAX_PACKET_SIZE                   , PTYPE_UINT, 200, NULL},
+  {"CL_DEVICE_PIPE_SUPPORT"                           , CL_DEVICE_PIPE_SUPPORT                           , PTYPE_BOOL, 300, NULL},
+  {"CL_DEVICE_PLATFORM"                               , CL_DEVICE_PLATFORM                               , PTYPE_PLFM,   0, NULL},
+  {"CL_DEVICE_PREFERRED_GLOBAL_ATOMIC_ALIGNMENT"      , CL_DEVICE_PREFERRED_GLOBAL_ATOMIC_ALIGNMENT      , PTYPE_UINT, 200, NULL},
+  {"CL_DEVICE_PREFERRED_LOCAL_ATOMIC_ALIGNMENT"       , CL_DEVICE_PREFERRED_LOCAL_ATOMIC_ALIGNMENT       , PTYPE_UINT, 200, NULL},
+  {"CL_DEVICE_PREFERRED_PLATFORM_ATOMIC_ALIGNMENT"    , CL_DEVICE_PREFERRED_PLATFORM_ATOMIC_ALIGNMENT    , PTYPE_UINT, 200, NULL},
+  {"CL_DEVICE_PREFERRED_VECTOR_WIDTH_CHAR"            , CL_DEVICE_PREFERRED_VECTOR_WIDTH_CHAR            , PTYPE_UINT,   0, NULL},
+  {"CL_DEVICE_PREFERRED_VECTOR_WIDTH_DOUBLE"          , CL_DEVICE_PREFERRED_VECTOR_WIDTH_DOUBLE          , PTYPE_UINT,   0, NULL},
+  {"CL_DEVICE_PREFERRED_VECTOR_WIDTH_FLOAT"           , CL_DEVICE_PREFERRED_VECTOR_WIDTH_FLOAT           , PTYPE_UINT,   0, NULL},
+  {"CL_DEVICE_PREFERRED_VECTOR_WIDTH_HALF"            , CL_DEVICE_PREFERRED_VECTOR_WIDTH_HALF            , PTYPE_UINT, 110, NULL},
+  {"CL_DEVICE_PREFERRED_VECTOR_WIDTH_INT"             , CL_DEVICE_PREFERRED_VECTOR_WIDTH_INT             , PTYPE_UINT,   0, NULL},
+  {"CL_DEVICE_PREFERRED_VECTOR_WIDTH_LONG"            , CL_DEVICE_PREFERRED_VECTOR_WIDTH_LONG            , PTYPE_UINT,   0, NULL},
+  {"CL_DEVICE_PREFERRED_VECTOR_WIDTH_SHORT"           , CL_DEVICE_PREFERRED_VECTOR_WIDTH_SHORT           , PTYPE_UINT,   0, NULL},
+  {"CL_DEVICE_PREFERRED_WORK_GROUP_SIZE_MULTIPLE"     , CL_DEVICE_PREFERRED_WORK_GROUP_SIZE_MULTIPLE     , PTYPE_SIZT, 300, NULL},
+  {"CL_DEVICE_PRINTF_BUFFER_SIZE"                     , CL_DEVICE_PRINTF_BUFFER_SIZE                     , PTYPE_SIZT, 120, NULL},
+  {"CL_DEVICE_PROFILE"                                , CL_DEVICE_PROFILE                                , PTYPE_CHAR,   0, NULL},
+  {"CL_DEVICE_PROFILING_TIMER_RESOLUTION"             , CL_DEVICE_PROFILING_TIMER_RESOLUTION             , PTYPE_SIZT,   0, NULL},
+  {"CL_DEVICE_QUEUE_ON_DEVICE_MAX_SIZE"               , CL_DEVICE_QUEUE_ON_DEVICE_MAX_SIZE               , PTYPE_UINT, 200, NULL},
+  {"CL_DEVICE_QUEUE_ON_DEVICE_PREFERRED_SIZE"         , CL_DEVICE_QUEUE_ON_DEVICE_PREFERRED_SIZE         , PTYPE_UINT, 200, NULL},
+  {"CL_DEVICE_QUEUE_ON_DEVICE_PROPERTIES"             , CL_DEVICE_QUEUE_ON_DEVICE_PROPERTIES             , PTYPE_BITF, 200, NULL},
+  {"CL_DEVICE_STABLE_KEY"                             , 0                                                , PTYPE_DKEY,   0, NULL},
+  {"CL_DEVICE_SUB_GROUP_INDEPENDENT_FORWARD_PROGRESS" , CL_DEVICE_SUB_GROUP_INDEPENDENT_FORWARD_PROGRESS , PTYPE_BOOL, 210, NULL},
+  {"CL_DEVICE_SUB_GROUP_SIZES_INTEL"                  , CL_DEVICE_SUB_GROUP_SIZES_INTEL                  , PTYPE_SZTA,   0, "cl_intel_required_subgroup_size"},
+  {"CL_DEVICE_SVM_CAPABILITIES"                       , CL_DEVICE_SVM_CAPABILITIES                       , PTYPE_BITF, 200, NULL},
+  {"CL_DEVICE_TOPOLOGY_AMD"                           , CL_DEVICE_TOPOLOGY_AMD                           , PTYPE_PCIA,   0, "cl_amd_device_attribute_query"},
+  {"CL_DEVICE_TYPE"                                   , CL_DEVICE_TYPE                                   , PTYPE_DEVC,   0, NULL},
+  {"CL_DEVICE_TYPE_BITFIELD"                          , CL_DEVICE_TYPE                                   , PTYPE_BITF,   0, NULL},
+  {"CL_DEVICE_UUID_KHR"                               , CL_DEVICE_UUID_KHR                               , PTYPE_UUID,   0, "cl_khr_device_uuid"},
+  {"CL_DEVICE_VENDOR"                                 , CL_DEVICE_VENDOR                                 , PTYPE_CHAR,   0, NULL},
+  {"CL_DEVICE_VENDOR_ID"                              , CL_DEVICE_VENDOR_ID                              , PTYPE_UINT,   0, NULL},
+  {"CL_DEVICE_VERSION"                                , CL_DEVICE_VERSION                                , PTYPE_CHAR,   0, NULL},
+  {"CL_DEVICE_WORK_GROUP_COLLECTIVE_FUNCTIONS_SUPPORT", CL_DEVICE_WORK_GROUP_COLLECTIVE_FUNCTIONS_SUPPORT, PTYPE_BOOL, 300, NULL},
+  {"CL_DRIVER_UUID_KHR"                               , CL_DRIVER_UUID_KHR                               , PTYPE_UUID,   0, "cl_khr_device_uuid"},
+  {"CL_DRIVER_VERSION"                                , CL_DRIVER_VERSION                                , PTYPE_CHAR,   0, NULL},
+  {"CL_PLATFORM_EXTENSIONS"                           , CL_PLATFORM_EXTENSIONS                           , PTYPE_PCHR,   0, NULL},
+  {"CL_PLATFORM_NAME"                                 , CL_PLATFORM_NAME                                 , PTYPE_PCHR,   0, NULL},
+  {"CL_PLATFORM_PROFILE"                              , CL_PLATFORM_PROFILE                              , PTYPE_PCHR,   0, NULL},
+  {"CL_PLATFORM_VENDOR"                               , CL_PLATFORM_VENDOR                               , PTYPE_PCHR,   0, NULL},
+  {"CL_PLATFORM_VERSION"                              , CL_PLATFORM_VERSION                              , PTYPE_PCHR,   0, NULL},
+};
+constexpr size_t NUM_OCL_PROPS = sizeof(OCL_PROPS) / sizeof(OCL_PROPS[0]);
+
+// compile-time validation of the table ordering
+constexpr int constStrCmp(const char * a, const char * b){
+  return (*a != *b) ? ((unsigned char) *a < (unsigned char) *b ? -1 : 1) : (*a ? constStrCmp(a + 1, b + 1) : 0);
+}
+constexpr bool propsSorted(const PropInfo * p, size_t n){
+  return n < 2 || (constStrCmp(p[0].name, p[1].name) < 0 && propsSorted(p + 1, n - 1));
+}
+static_assert(propsSorted(OCL_PROPS, NUM_OCL_PROPS), "OCL_PROPS must be sorted by name with no duplicates.");
+
+// binary search for a property by name - NULL if not found
+const PropInfo * findProp(const char * name){
+  const PropInfo * p = std::lower_bound(OCL_PROPS, OCL_PROPS + NUM_OCL_PROPS, name,
+    [](PropInfo const& a, const char * b){ return strcmp(a.name, b) < 0; });
+  return (p != OCL_PROPS + NUM_OCL_PROPS && !strcmp(p->name, name)) ? p : NULL;
+}
+
+// native value of a single property on a single device
+struct PropValue {
+  bool valid = false; // whether the query succeeded
+  cl_ulong num = 0; // PTYPE_BOOL, PTYPE_UINT, PTYPE_ULNG, PTYPE_SIZT, PTYPE_PLFM, PTYPE_BITF, PTYPE_AVMM, PTYPE_PRNT
+  std::string txt; // PTYPE_CHAR, PTYPE_DEVC, PTYPE_PCHR, PTYPE_VERS, PTYPE_NVER, PTYPE_PCIA, PTYPE_UUID, PTYPE_DKEY
+  std::vector<size_t> arr; // PTYPE_SZTA
+};
+
+// human readable device type (a bitfield)
+std::string deviceTypeString(cl_device_type id){
+  std::string txt="";
+  if (id & CL_DEVICE_TYPE_CPU        ) {txt += "cpu | ";}
+  if (id & CL_DEVICE_TYPE_GPU        ) {txt += "gpu | ";}
+  if (id & CL_DEVICE_TYPE_ACCELERATOR) {txt += "accelerator | ";}
+  if (id & CL_DEVICE_TYPE_DEFAULT    ) {txt += "default | ";}
+  if (id & CL_DEVICE_TYPE_CUSTOM     ) {txt += "custom | ";}
+  if (!txt.empty()) txt.erase(txt.length() - 3); // delete separators at the end
+  return txt;
+}
+
+// human readable cl_version
+std::string versionString(cl_uint v){
+  return std::to_string(v >> 22) + "." + std::to_string((v >> 12) & 0x3FF) + "." + std::to_string(v & 0xFFF);
+}
+
+// per-device capabilities gating which properties can be queried
+struct DeviceCaps {
+  int version = 0; // e.g. 210 for "OpenCL 2.1 <vendor>"
+  std::string extensions; // space separated
+};
+
+DeviceCaps queryCaps(cl_device_id d){
+  DeviceCaps caps;
+  caps.version = deviceVersion(d);
+  size_t n = 0;
+  if (clGetDeviceInfo(d, CL_DEVICE_EXTENSIONS, 0, NULL, &n) == CL_SUCCESS) {
+    std::vector<char> buf(n + 1, '\0');
+    if (clGetDeviceInfo(d, CL_DEVICE_EXTENSIONS, n, buf.data(), NULL) == CL_SUCCESS) {caps.extensions = buf.data();}
   }
+  return caps;
+}
 
-  return devs;
+// whether the device reports an extension
+bool hasExtension(DeviceCaps const& caps, const char * ext){
+  return (" " + caps.extensions + " ").find(" " + std::string(ext) + " ") != std::string::npos;
+}
+
+// whether the device can answer the query
+bool supportsProp(DeviceCaps const& caps, PropInfo const& prop){
+  if (prop.version > caps.version) return false;
+  if (prop.ext && !hasExtension(caps, prop.ext)) return false;
+  return true;
+}
+
+// query a property from the platform (no mx calls)
+PropValue queryPlatformProp(cl_platform_id p, PropInfo const& prop){
+  PropValue v;
+  if (prop.type != PTYPE_PCHR) return v; // device property
+  size_t n = 0;
+  v.valid = clGetPlatformInfo(p, prop.id, 0, NULL, &n) == CL_SUCCESS;
+  std::vector<char> buf(n + 1, '\0');
+  v.valid = v.valid && clGetPlatformInfo(p, prop.id, n, buf.data(), NULL) == CL_SUCCESS;
+  v.txt = v.valid ? buf.data() : "";
+  return v;
+}
+
+// PCI address as "dddd:bb:dd.f" (as in sysfs), or "" if not known
+std::string pciAddressString(cl_uint domain, cl_uint bus, cl_uint device, cl_uint function){
+  char txt[32];
+  snprintf(txt, sizeof(txt), "%04x:%02x:%02x.%x", domain, bus, device, function);
+  return txt;
+}
+
+// PCI address from the given topology query, or from the first one available if 0
+std::string queryPciAddress(cl_device_id d, cl_device_info id, DeviceCaps const& caps){
+  if ((!id || id == CL_DEVICE_PCI_BUS_INFO_KHR) && hasExtension(caps, "cl_khr_pci_bus_info")){
+    PciBusInfoKhr x;
+    if (clGetDeviceInfo(d, CL_DEVICE_PCI_BUS_INFO_KHR, sizeof(x), &x, NULL) == CL_SUCCESS)
+      return pciAddressString(x.domain, x.bus, x.device, x.function);
+  }
+  if ((!id || id == CL_DEVICE_TOPOLOGY_AMD) && hasExtension(caps, "cl_amd_device_attribute_query")){
+    TopologyAmd x;
+    if (clGetDeviceInfo(d, CL_DEVICE_TOPOLOGY_AMD, sizeof(x), &x, NULL) == CL_SUCCESS
+      && x.raw.type == CL_DEVICE_TOPOLOGY_TYPE_PCIE_AMD)
+      return pciAddressString(0, x.pcie.bus, x.pcie.device, x.pcie.function);
+  }
+  if (!id && hasExtension(caps, "cl_nv_device_attribute_query")){
+    cl_uint bus, slot, domain = 0;
+    if (clGetDeviceInfo(d, CL_DEVICE_PCI_BUS_ID_NV , sizeof(bus ), &bus , NULL) == CL_SUCCESS
+     && clGetDeviceInfo(d, CL_DEVICE_PCI_SLOT_ID_NV, sizeof(slot), &slot, NULL) == CL_SUCCESS){
+      clGetDeviceInfo(d, CL_DEVICE_PCI_DOMAIN_ID_NV, sizeof(domain), &domain, NULL); // newer drivers only
+      return pciAddressString(domain, bus, slot >> 3, slot & 7);
+    }
+  }
+  return "";
+}
+
+// 16 byte UUID as lower-case hex, or "" if not known
+std::string queryUuid(cl_device_id d, cl_device_info id, DeviceCaps const& caps){
+  unsigned char x[16];
+  if (!hasExtension(caps, "cl_khr_device_uuid") || clGetDeviceInfo(d, id, sizeof(x), x, NULL) != CL_SUCCESS) return "";
+  char txt[2 * sizeof(x) + 1];
+  for (size_t k = 0; k < sizeof(x); ++k) {snprintf(txt + 2 * k, 3, "%02x", x[k]);}
+  return txt;
+}
+
+// NUMA node of a PCI device, or -1 if unknown
+int pciNumaNode(std::string const& addr){
+  int node = -1;
+#ifdef __linux__
+  if (addr.empty()) return node;
+  FILE * f = fopen(("/sys/bus/pci/devices/" + addr + "/numa_node").c_str(), "r");
+  if (f) {
+    if (fscanf(f, "%d", &node) != 1) node = -1;
+    fclose(f);
+  }
+#endif
+  return node;
+}
+
+// query a property from the device (no mx calls)
+PropValue queryProp(cl::Device const& dev, PropInfo const& prop, DeviceCaps const& caps){
+  PropValue v;
+  const cl_device_id d = dev();
+  if (!supportsProp(caps, prop)) return v; // not available on this device
+  switch (prop.type){
+    case PTYPE_ULNG:{
+      cl_ulong x;
+      v.valid = clGetDeviceInfo(d, prop.id, sizeof(x), &x, NULL) == CL_SUCCESS;
+      v.num = x;
+      } break;
+    case PTYPE_SIZT:{
+      size_t x;
+      v.valid = clGetDeviceInfo(d, prop.id, sizeof(x), &x, NULL) == CL_SUCCESS;
+      v.num = x;
+      } break;
+    case PTYPE_UINT:{
+      cl_uint x;
+      v.valid = clGetDeviceInfo(d, prop.id, sizeof(x), &x, NULL) == CL_SUCCESS;
+      v.num = x;
+      } break;
+    case PTYPE_BOOL:{
+      cl_bool x;
+      v.valid = clGetDeviceInfo(d, prop.id, sizeof(x), &x, NULL) == CL_SUCCESS;
+      v.num = x;
+      } break;
+    case PTYPE_SZTA:{
+      size_t n = 0;
+      v.valid = clGetDeviceInfo(d, prop.id, 0, NULL, &n) == CL_SUCCESS;
+      v.arr.resize(n / sizeof(size_t));
+      v.valid = v.valid && clGetDeviceInfo(d, prop.id, n, v.arr.data(), NULL) == CL_SUCCESS;
+      } break;
+    case PTYPE_CHAR:{
+      size_t n = 0;
+      v.valid = clGetDeviceInfo(d, prop.id, 0, NULL, &n) == CL_SUCCESS;
+      std::vector<char> buf(n + 1, '\0');
+      v.valid = v.valid && clGetDeviceInfo(d, prop.id, n, buf.data(), NULL) == CL_SUCCESS;
+      v.txt = buf.data(); // stops at the null terminator
+      } break;
+    case PTYPE_DEVC:{
+      cl_device_type x;
+      v.valid = clGetDeviceInfo(d, prop.id, sizeof(x), &x, NULL) == CL_SUCCESS;
+      v.num = x;
+      v.txt = deviceTypeString(x);
+      } break;
+    case PTYPE_BITF:{
+      cl_bitfield x;
+      v.valid = clGetDeviceInfo(d, prop.id, sizeof(x), &x, NULL) == CL_SUCCESS;
+      v.num = x;
+      } break;
+    case PTYPE_VERS:{
+      cl_uint x;
+      v.valid = clGetDeviceInfo(d, prop.id, sizeof(x), &x, NULL) == CL_SUCCESS;
+      v.num = x;
+      v.txt = versionString(x);
+      } break;
+    case PTYPE_NVER:{
+      size_t n = 0;
+      v.valid = clGetDeviceInfo(d, prop.id, 0, NULL, &n) == CL_SUCCESS;
+      std::vector<NameVersion> nv(n / sizeof(NameVersion));
+      v.valid = v.valid && clGetDeviceInfo(d, prop.id, nv.size() * sizeof(NameVersion), nv.data(), NULL) == CL_SUCCESS;
+      for (NameVersion const& x : nv){
+        v.txt += std::string(x.name, strnlen(x.name, sizeof(x.name))) + " " + versionString(x.version) + " | ";
+      }
+      if (!v.txt.empty()) v.txt.erase(v.txt.length() - 3); // delete separators at the end
+      } break;
+    case PTYPE_PCIA:{
+      v.txt = queryPciAddress(d, prop.id, caps);
+      v.valid = !v.txt.empty();
+      } break;
+    case PTYPE_UUID:{
+      v.txt = queryUuid(d, prop.id, caps);
+      v.valid = !v.txt.empty();
+      } break;
+    case PTYPE_NUMA:{
+      v.num = (cl_ulong) (cl_long) pciNumaNode(queryPciAddress(d, 0, caps));
+      v.valid = true;
+      } break;
+    case PTYPE_DKEY:{
+      // prefer the physical location, then the UUID, then the name
+      std::string pci = queryPciAddress(d, 0, caps);
+      std::string uuid = pci.empty() ? queryUuid(d, CL_DEVICE_UUID_KHR, caps) : "";
+      if      (!pci.empty() ) v.txt = "pci:" + pci;
+      else if (!uuid.empty()) v.txt = "uuid:" + uuid;
+      else {
+        PropValue name = queryProp(dev, PropInfo{NULL, CL_DEVICE_NAME, PTYPE_CHAR, 0, NULL}, caps);
+        v.txt = "name:" + name.txt; // disambiguated across devices when staged
+      }
+      v.valid = true;
+      } break;
+    case PTYPE_AVMM:{
+      // N.B. NVIDIA and Intel do not expose free memory through OpenCL
+      if (hasExtension(caps, "cl_amd_device_attribute_query")){
+        size_t n = 0;
+        v.valid = clGetDeviceInfo(d, CL_DEVICE_GLOBAL_FREE_MEMORY_AMD, 0, NULL, &n) == CL_SUCCESS && n >= sizeof(size_t);
+        std::vector<size_t> kb(n / sizeof(size_t)); // total free, largest free block (KB)
+        v.valid = v.valid && clGetDeviceInfo(d, CL_DEVICE_GLOBAL_FREE_MEMORY_AMD, n, kb.data(), NULL) == CL_SUCCESS;
+        v.num = v.valid ? (cl_ulong) kb[0] * 1024 : 0;
+      }
+      } break;
+    case PTYPE_PRNT:{
+      cl_device_id x;
+      v.valid = clGetDeviceInfo(d, prop.id, sizeof(x), &x, NULL) == CL_SUCCESS;
+      v.num = v.valid ? deviceIndex(x) : 0; // 1-based index
+      } break;
+    case PTYPE_PLFM:{
+      cl_platform_id x;
+      v.valid = clGetDeviceInfo(d, prop.id, sizeof(x), &x, NULL) == CL_SUCCESS;
+      v.num = v.valid ? platformIndex(x) : 0; // 1-based index
+      } break;
+    case PTYPE_PCHR:{
+      cl_platform_id x;
+      v.valid = clGetDeviceInfo(d, CL_DEVICE_PLATFORM, sizeof(x), &x, NULL) == CL_SUCCESS;
+      if (v.valid) v = queryPlatformProp(x, prop); // property of this device's platform
+      } break;
+    default: break; // not enumerated
+  }
+  if (!v.valid) v = PropValue(); // reset partial results
+  return v;
+}
+
+// query all properties of all devices, one worker thread per device
+// N.B. workers must not call the mx API - results are staged natively
+std::vector<std::vector<PropValue>> stageProps(std::vector<cl::Device> const& devs, std::vector<PropInfo> const& props){
+  std::vector<std::vector<PropValue>> vals(devs.size(), std::vector<PropValue>(props.size()));
+  auto work = [&](size_t i){
+    const DeviceCaps caps = queryCaps(devs[i]());
+    for(size_t j = 0; j < props.size(); ++j) {vals[i][j] = queryProp(devs[i], props[j], caps);}
+  };
+
+  if (devs.size() < 2) { // no need for threads on a single device
+    for(size_t i = 0; i < devs.size(); ++i) {work(i);}
+  } else {
+    std::vector<std::thread> workers;
+    for(size_t i = 0; i < devs.size(); ++i) {workers.emplace_back(work, i);}
+    for(std::thread& t : workers) {t.join();}
+  }
+
+  // disambiguate identical device keys by their order of enumeration
+  for(size_t j = 0; j < props.size(); ++j){
+    if (props[j].type != PTYPE_DKEY) continue;
+    for(size_t i = 0; i < devs.size(); ++i){
+      size_t k = 0, n = 0; // ordinal, count
+      for(size_t m = 0; m < devs.size(); ++m){
+        if (vals[m][j].txt != vals[i][j].txt) continue;
+        if (m < i) ++k;
+        ++n;
+      }
+      if (n > 1) vals[i][j].txt += "#" + std::to_string(k + 1);
+    }
+  }
+  return vals;
+}
+
+// convert a property value to a MATLAB scalar (or row vector)
+mxArray * propToMx(PropValue const& v, char type){
+  mxArray * mw_info;
+  if (!v.valid) type = 0; // failed query -> empty double
+  switch (type){
+    case PTYPE_ULNG:
+    case PTYPE_SIZT:
+    case PTYPE_BITF:
+    case PTYPE_AVMM:{
+      mw_info = mxCreateUninitNumericMatrix(1,1,mxUINT64_CLASS, mxREAL);
+      *mxGetUint64s(mw_info) = v.num;
+      } break;
+    case PTYPE_UINT:
+    case PTYPE_PLFM:
+    case PTYPE_PRNT:{
+      mw_info = mxCreateUninitNumericMatrix(1,1,mxUINT32_CLASS, mxREAL);
+      *mxGetUint32s(mw_info) = (mxUint32) v.num;
+      } break;
+    case PTYPE_BOOL:{
+      mw_info = mxCreateLogicalScalar(v.num != 0);
+      } break;
+    case PTYPE_NUMA:{
+      mw_info = mxCreateUninitNumericMatrix(1,1,mxINT32_CLASS, mxREAL);
+      *mxGetInt32s(mw_info) = (mxInt32) (cl_long) v.num;
+      } break;
+    case PTYPE_SZTA:{
+      mw_info = mxCreateNumericMatrix(1,v.arr.size(),mxUINT64_CLASS, mxREAL);
+      mxUint64 * x = mxGetUint64s(mw_info);
+      for(size_t k = 0; k < v.arr.size(); ++k) {x[k] = v.arr[k];}
+      } break;
+    case PTYPE_CHAR:
+    case PTYPE_DEVC:
+    case PTYPE_PCHR:
+    case PTYPE_VERS:
+    case PTYPE_NVER:
+    case PTYPE_PCIA:
+    case PTYPE_UUID:
+    case PTYPE_DKEY:{
+      mw_info = mxCreateString(v.txt.c_str()); // pass string to MATLAB
+      } break;
+    default:{
+      // not enumerated -> empty double
+      mw_info = mxCreateNumericMatrix(0,0,mxDOUBLE_CLASS,mxREAL);
+      } break;
+  }
+  return mw_info;
+}
+
+// convert a property's values across devices to a MATLAB column
+mxArray * propsToMxColumn(std::vector<PropValue> const& v, char type){
+  const mwSize N = v.size();
+  mxArray * col;
+  switch (type){
+    case PTYPE_ULNG:
+    case PTYPE_SIZT:
+    case PTYPE_BITF:{
+      col = mxCreateNumericMatrix(N,1,mxUINT64_CLASS, mxREAL);
+      mxUint64 * x = mxGetUint64s(col);
+      for(mwIndex i = 0; i < N; ++i) {x[i] = v[i].num;}
+      } break;
+    case PTYPE_AVMM:{
+      col = mxCreateNumericMatrix(N,1,mxDOUBLE_CLASS, mxREAL);
+      mxDouble * x = mxGetDoubles(col);
+      for(mwIndex i = 0; i < N; ++i) {x[i] = v[i].valid ? (double) v[i].num : mxGetNaN();}
+      } break;
+    case PTYPE_UINT:
+    case PTYPE_PLFM:
+    case PTYPE_PRNT:{
+      col = mxCreateNumericMatrix(N,1,mxUINT32_CLASS, mxREAL);
+      mxUint32 * x = mxGetUint32s(col);
+      for(mwIndex i = 0; i < N; ++i) {x[i] = (mxUint32) v[i].num;}
+      } break;
+    case PTYPE_NUMA:{
+      col = mxCreateNumericMatrix(N,1,mxINT32_CLASS, mxREAL);
+      mxInt32 * x = mxGetInt32s(col);
+      for(mwIndex i = 0; i < N; ++i) {x[i] = v[i].valid ? (mxInt32) (cl_long) v[i].num : -1;}
+      } break;
+    case PTYPE_BOOL:{
+      col = mxCreateLogicalMatrix(N,1);
+      mxLogical * x = mxGetLogicals(col);
+      for(mwIndex i = 0; i < N; ++i) {x[i] = v[i].num != 0;}
+      } break;
+    case PTYPE_SZTA:{
+      // zero-padded to the longest array
+      size_t K = 0;
+      for(mwIndex i = 0; i < N; ++i) {K = std::max(K, v[i].arr.size());}
+      col = mxCreateNumericMatrix(N,K,mxUINT64_CLASS, mxREAL);
+      mxUint64 * x = mxGetUint64s(col);
+      for(mwIndex i = 0; i < N; ++i) {
+        for(size_t k = 0; k < v[i].arr.size(); ++k) {x[i + k * N] = v[i].arr[k];}
+      }
+      } break;
+    case PTYPE_CHAR:
+    case PTYPE_DEVC:
+    case PTYPE_PCHR:
+    case PTYPE_VERS:
+    case PTYPE_NVER:
+    case PTYPE_PCIA:
+    case PTYPE_UUID:
+    case PTYPE_DKEY:{
+      // cellstr -> string array in a single call
+      mxArray * c = mxCreateCellMatrix(N,1);
+      for(mwIndex i = 0; i < N; ++i) {mxSetCell(c, i, mxCreateString(v[i].txt.c_str()));}
+      mexCallMATLAB(1, &col, 1, &c, "string");
+      mxDestroyArray(c);
+      } break;
+    default:{
+      // not enumerated -> empty double column
+      col = mxCreateNumericMatrix(N,0,mxDOUBLE_CLASS,mxREAL);
+      } break;
+  }
+  return col;
 }
 
 void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
 
     // input:  {cell-array of property names to request}
     // output: {cell-array of outputs}
+    //
+    // input:  {cell-array of property names to request}, 'columns'
+    // output: struct with a typed column (one row per device) per property
+    //
+    // input:  {cell-array of CL_PLATFORM_* names to request}, 'platforms'
+    // output: struct with a typed column (one row per platform) per property
+    //
+    // input:  'refresh' - re-enumerate the cached devices (drops sub-devices)
+    // output: number of devices
+    //
+    // input:  'count' - output: number of devices (with sub-devices)
+    //
+    // input:  'partition', device index, mode, values
+    //         mode 'equally'  - values: compute units per sub-device
+    //         mode 'counts'   - values: compute units of each sub-device
+    //         mode 'affinity' - values: one of 'numa', 'l4', 'l3', 'l2', 'l1', 'next'
+    // output: indices of the new sub-devices
+
+  // release the device cache with the mex-file
+  mexAtExit(releaseOclDevices);
+
+  // commands
+  if(nrhs >= 1 && mxIsChar(prhs[0])){
+    char * cmd = mxArrayToString(prhs[0]);
+    const bool refresh   = !strcmp(cmd, "refresh"  );
+    const bool count     = !strcmp(cmd, "count"    );
+    const bool partition = !strcmp(cmd, "partition");
+    mxFree(cmd);
+    if(refresh || count){
+      plhs[0] = mxCreateDoubleScalar((double) getOclDevices(refresh).size());
+      return;
+    }
+    if(!partition){
+      mexErrMsgIdAndTxt("MatCL:cl_get_device_info:UnknownCommand",
+             "Unknown command. The supported commands are 'refresh', 'count', and 'partition'.");
+      return;
+    }
+
+    // validate
+    if(nrhs < 4 || !mxIsNumeric(prhs[1]) || !mxIsScalar(prhs[1]) || !mxIsChar(prhs[2])){
+      mexErrMsgIdAndTxt("MatCL:cl_get_device_info:InvalidPartition",
+             "Usage: cl_get_device_info('partition', index, mode, values).");
+      return;
+    }
+    const size_t idx = (size_t) mxGetScalar(prhs[1]);
+    char * mode = mxArrayToString(prhs[2]);
+    char * dom = mxIsChar(prhs[3]) ? mxArrayToString(prhs[3]) : NULL;
+    std::vector<double> vals;
+    if (mxIsNumeric(prhs[3])) {
+      mxArray * c = NULL; // values as double
+      mexCallMATLAB(1, &c, 1, (mxArray **) &prhs[3], "double");
+      vals.assign(mxGetDoubles(c), mxGetDoubles(c) + mxGetNumberOfElements(c));
+      mxDestroyArray(c);
+    }
+    const std::vector<cl_device_partition_property> props = partitionProperties(mode, vals, dom);
+    if (dom) mxFree(dom);
+    mxFree(mode);
+    if(props.empty()){
+      mexErrMsgIdAndTxt("MatCL:cl_get_device_info:InvalidPartition",
+             "The partition mode must be 'equally' or 'counts' with numeric values, or 'affinity' with one of 'numa', 'l4', 'l3', 'l2', 'l1', or 'next'.");
+      return;
+    }
+
+    const std::vector<size_t> inds = partitionOclDevice(idx, props);
+    if(inds.empty()){
+      mexErrMsgIdAndTxt("MatCL:cl_get_device_info:PartitionFailed",
+             "Device %d could not be partitioned as requested. Check CL_DEVICE_PARTITION_MAX_SUB_DEVICES and CL_DEVICE_PARTITION_AFFINITY_DOMAIN.", (int) idx);
+      return;
+    }
+    plhs[0] = mxCreateDoubleMatrix(1, inds.size(), mxREAL);
+    for (size_t k = 0; k < inds.size(); ++k) {mxGetDoubles(plhs[0])[k] = (double) inds[k];}
+    return;
+  }
 
-  std::vector<cl::Device> devs = getOclDevices();
-  
   // validate that the (only) input is a cell array
   if(nrhs < 1 || !mxIsCell(prhs[0])){
     // error case - requires one input char array
@@ -70,133 +733,79 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
   }
   
   
-  // get OpenCl device names  
-  cl_device_info prop_num;
-  char prop_type = 0;
+  // get (cached) OpenCL devices
+  std::vector<cl::Device> const& devs = getOclDevices();
+
+  // resolve each requested property once
+  std::vector<PropInfo> props(num_props);
+  for(mwIndex j = 0; j < num_props; ++j){
+    char * prop_name = mxArrayToString(mxGetCell(prhs[0], j)); // requested property
+    const PropInfo * p = findProp(prop_name);
+    props[j] = p ? *p : PropInfo{NULL, 0, 0, 0, NULL}; // type 0 -> not enumerated
+    mxFree(prop_name);
+  }
   
+  // columnar output
+  if(nrhs >= 2){
+    char * mode = mxIsChar(prhs[1]) ? mxArrayToString(prhs[1]) : NULL;
+    const bool columns   = mode && !strcmp(mode, "columns"  );
+    const bool platforms = mode && !strcmp(mode, "platforms");
+    mxFree(mode);
+    if(!columns && !platforms){
+      mexErrMsgIdAndTxt("MatCL:cl_get_device_info:UnknownMode",
+             "The output mode must be one of 'columns' or 'platforms'.");
+      return;
+    }
+
+    // query each device (concurrently) or each platform
+    std::vector<std::vector<PropValue>> staged;
+    if (columns) {
+      staged = stageProps(devs, props);
+    } else {
+      std::vector<cl::Platform> const& plats = getOclPlatforms();
+      staged.assign(plats.size(), std::vector<PropValue>(num_props));
+      for(size_t i = 0; i < plats.size(); ++i){
+        for(mwIndex j = 0; j < num_props; ++j) {staged[i][j] = queryPlatformProp(plats[i](), props[j]);}
+      }
+    }
+
+    mxArray * s = mxCreateStructMatrix(1, 1, 0, NULL);
+    std::vector<PropValue> vals(staged.size());
+    for(mwIndex j = 0; j < num_props; ++j){
+      char * prop_name = mxArrayToString(mxGetCell(prhs[0], j)); // field name
+      const bool dup = mxGetFieldNumber(s, prop_name) >= 0;
+      const int f = dup ? -1 : mxAddField(s, prop_name);
+      mxFree(prop_name);
+      if(dup) continue; // already queried
+      if(f < 0){
+        mexErrMsgIdAndTxt("MatCL:cl_get_device_info:InvalidFieldName",
+               "Each requested property must be a unique, valid field name in 'columns' or 'platforms' mode.");
+        return;
+      }
+      for(size_t i = 0; i < staged.size(); ++i) {vals[i] = staged[i][j];}
+      mxSetFieldByNumber(s, 0, f, propsToMxColumn(vals, platforms && props[j].type != PTYPE_PCHR ? 0 : props[j].type));
+    }
+
+    plhs[0] = s;
+    return;
+  }
+
+  // query all devices concurrently
+  const std::vector<std::vector<PropValue>> staged = stageProps(devs, props);
+
   // allocate output
   mxArray * cell_array_ptr = mxCreateCellMatrix(num_props, devs.size());
 
   // for each device ...
-  // mexPrintf("Discovering ..."); // DEBUG
   for (mwIndex i = 0; i < devs.size(); i++) {
     for(mwIndex j = 0; j < num_props; ++j){
-        char * prop_name = (char *) mxArrayToString(mxGetCell(prhs[0], j)); // requested property
-        
-        // mexPrintf("Searching for '"); mexPrintf(prop_name); mexPrintf("' ... "); // DEBUG
-        
-        prop_type = 0; // init
-        if (!strcmp(prop_name, "CL_DEVICE_ADDRESS_BITS"                   )){prop_type = PTYPE_UINT; prop_num = CL_DEVICE_ADDRESS_BITS                   ;} 
-        if (!strcmp(prop_name, "CL_DEVICE_AVAILABLE"                      )){prop_type = PTYPE_BOOL; prop_num = CL_DEVICE_AVAILABLE                      ;} 
-        if (!strcmp(prop_name, "CL_DEVICE_BUILT_IN_KERNELS"               )){prop_type = PTYPE_CHAR; prop_num = CL_DEVICE_BUILT_IN_KERNELS               ;} 
-        if (!strcmp(prop_name, "CL_DEVICE_COMPILER_AVAILABLE"             )){prop_type = PTYPE_BOOL; prop_num = CL_DEVICE_COMPILER_AVAILABLE             ;} 
-        if (!strcmp(prop_name, "CL_DEVICE_EXTENSIONS"                     )){prop_type = PTYPE_CHAR; prop_num = CL_DEVICE_EXTENSIONS                     ;} 
-        if (!strcmp(prop_name, "CL_DEVICE_GLOBAL_MEM_CACHE_SIZE"          )){prop_type = PTYPE_ULNG; prop_num = CL_DEVICE_GLOBAL_MEM_CACHE_SIZE          ;} 
-        if (!strcmp(prop_name, "CL_DEVICE_GLOBAL_MEM_CACHELINE_SIZE"      )){prop_type = PTYPE_UINT; prop_num = CL_DEVICE_GLOBAL_MEM_CACHELINE_SIZE      ;} 
-        if (!strcmp(prop_name, "CL_DEVICE_GLOBAL_MEM_SIZE"                )){prop_type = PTYPE_ULNG; prop_num = CL_DEVICE_GLOBAL_MEM_SIZE                ;} 
-        if (!strcmp(prop_name, "CL_DEVICE_LINKER_AVAILABLE"               )){prop_type = PTYPE_BOOL; prop_num = CL_DEVICE_LINKER_AVAILABLE               ;} 
-        if (!strcmp(prop_name, "CL_DEVICE_LOCAL_MEM_SIZE"                 )){prop_type = PTYPE_ULNG; prop_num = CL_DEVICE_LOCAL_MEM_SIZE                 ;} 
-        if (!strcmp(prop_name, "CL_DEVICE_MAX_CLOCK_FREQUENCY"            )){prop_type = PTYPE_UINT; prop_num = CL_DEVICE_MAX_CLOCK_FREQUENCY            ;}
-        if (!strcmp(prop_name, "CL_DEVICE_MAX_COMPUTE_UNITS"              )){prop_type = PTYPE_UINT; prop_num = CL_DEVICE_MAX_COMPUTE_UNITS              ;}
-        if (!strcmp(prop_name, "CL_DEVICE_MAX_CONSTANT_ARGS"              )){prop_type = PTYPE_UINT; prop_num = CL_DEVICE_MAX_CONSTANT_ARGS              ;} 
-        if (!strcmp(prop_name, "CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE"       )){prop_type = PTYPE_ULNG; prop_num = CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE       ;} 
-        if (!strcmp(prop_name, "CL_DEVICE_MAX_MEM_ALLOC_SIZE"             )){prop_type = PTYPE_ULNG; prop_num = CL_DEVICE_MAX_MEM_ALLOC_SIZE             ;}
-        if (!strcmp(prop_name, "CL_DEVICE_MAX_PARAMETER_SIZE"             )){prop_type = PTYPE_ULNG; prop_num = CL_DEVICE_MAX_PARAMETER_SIZE             ;} 
-        if (!strcmp(prop_name, "CL_DEVICE_MAX_WORK_GROUP_SIZE"            )){prop_type = PTYPE_SIZT; prop_num = CL_DEVICE_MAX_WORK_GROUP_SIZE            ;}
-        if (!strcmp(prop_name, "CL_DEVICE_MAX_WORK_ITEM_DIMENSIONS"       )){prop_type = PTYPE_UINT; prop_num = CL_DEVICE_MAX_WORK_ITEM_DIMENSIONS       ;}
-        if (!strcmp(prop_name, "CL_DEVICE_MAX_WORK_ITEM_SIZES"            )){prop_type = PTYPE_SZTA; prop_num = CL_DEVICE_MAX_WORK_ITEM_SIZES            ;}
-        if (!strcmp(prop_name, "CL_DEVICE_OPENCL_C_VERSION"               )){prop_type = PTYPE_CHAR; prop_num = CL_DEVICE_OPENCL_C_VERSION               ;} 
-        if (!strcmp(prop_name, "CL_DEVICE_MAX_PARAMETER_SIZE"             )){prop_type = PTYPE_ULNG; prop_num = CL_DEVICE_MAX_PARAMETER_SIZE             ;} 
-        if (!strcmp(prop_name, "CL_DEVICE_NAME"                           )){prop_type = PTYPE_CHAR; prop_num = CL_DEVICE_NAME                           ;}
-        if (!strcmp(prop_name, "CL_DEVICE_PREFERRED_VECTOR_WIDTH_CHAR"    )){prop_type = PTYPE_UINT; prop_num = CL_DEVICE_PREFERRED_VECTOR_WIDTH_CHAR    ;}
-        if (!strcmp(prop_name, "CL_DEVICE_PREFERRED_VECTOR_WIDTH_SHORT"   )){prop_type = PTYPE_UINT; prop_num = CL_DEVICE_PREFERRED_VECTOR_WIDTH_SHORT   ;}
-        if (!strcmp(prop_name, "CL_DEVICE_PREFERRED_VECTOR_WIDTH_INT"     )){prop_type = PTYPE_UINT; prop_num = CL_DEVICE_PREFERRED_VECTOR_WIDTH_INT     ;}
-        if (!strcmp(prop_name, "CL_DEVICE_PREFERRED_VECTOR_WIDTH_LONG"    )){prop_type = PTYPE_UINT; prop_num = CL_DEVICE_PREFERRED_VECTOR_WIDTH_LONG    ;}
-        if (!strcmp(prop_name, "CL_DEVICE_PREFERRED_VECTOR_WIDTH_FLOAT"   )){prop_type = PTYPE_UINT; prop_num = CL_DEVICE_PREFERRED_VECTOR_WIDTH_FLOAT   ;}
-        if (!strcmp(prop_name, "CL_DEVICE_PREFERRED_VECTOR_WIDTH_DOUBLE"  )){prop_type = PTYPE_UINT; prop_num = CL_DEVICE_PREFERRED_VECTOR_WIDTH_DOUBLE  ;}
-        if (!strcmp(prop_name, "CL_DEVICE_PREFERRED_VECTOR_WIDTH_HALF"    )){prop_type = PTYPE_UINT; prop_num = CL_DEVICE_PREFERRED_VECTOR_WIDTH_HALF    ;}
-        if (!strcmp(prop_name, "CL_DEVICE_PRINTF_BUFFER_SIZE"             )){prop_type = PTYPE_SIZT; prop_num = CL_DEVICE_PRINTF_BUFFER_SIZE             ;}
-        if (!strcmp(prop_name, "CL_DEVICE_PROFILE"                        )){prop_type = PTYPE_CHAR; prop_num = CL_DEVICE_PROFILE                        ;}
-        if (!strcmp(prop_name, "CL_DEVICE_PROFILING_TIMER_RESOLUTION"     )){prop_type = PTYPE_SIZT; prop_num = CL_DEVICE_PROFILING_TIMER_RESOLUTION     ;}
-        if (!strcmp(prop_name, "CL_DEVICE_VENDOR"                         )){prop_type = PTYPE_CHAR; prop_num = CL_DEVICE_VENDOR                         ;}
-        if (!strcmp(prop_name, "CL_DEVICE_VENDOR_ID"                      )){prop_type = PTYPE_UINT; prop_num = CL_DEVICE_VENDOR_ID                      ;}
-        if (!strcmp(prop_name, "CL_DEVICE_VERSION"                        )){prop_type = PTYPE_CHAR; prop_num = CL_DEVICE_VERSION                        ;}
-        if (!strcmp(prop_name, "CL_DRIVER_VERSION"                        )){prop_type = PTYPE_CHAR; prop_num = CL_DRIVER_VERSION                        ;}        
-
-        // these need an extra step or two of look-up to give a meaningful result
-        if (!strcmp(prop_name, "CL_DEVICE_PLATFORM"                       )){prop_type = PTYPE_PLFM; prop_num = CL_DEVICE_PLATFORM                       ;}
-        if (!strcmp(prop_name, "CL_DEVICE_TYPE"                           )){prop_type = PTYPE_DEVC; prop_num = CL_DEVICE_TYPE                           ;}
-
-        // These are not supported by the header. They are likely > v1.2 queries.
-        // if (!strcmp(prop_name, "CL_DEVICE_MAX_GLOBAL_VARIABLE_SIZE"       )){prop_type = PTYPE_SIZT; prop_num = CL_DEVICE_MAX_GLOBAL_VARIABLE_SIZE       ;}
-        // if (!strcmp(prop_name, "CL_DEVICE_MAX_NUM_SUB_GROUPS"             )){prop_type = PTYPE_UINT; prop_num = CL_DEVICE_MAX_NUM_SUB_GROUPS             ;} 
-        // if (!strcmp(prop_name, "CL_DEVICE_MAX_ON_DEVICE_QUEUES"           )){prop_type = PTYPE_UINT; prop_num = CL_DEVICE_MAX_ON_DEVICE_QUEUES           ;} 
-        // if (!strcmp(prop_name, "CL_DEVICE_QUEUE_ON_DEVICE_MAX_SIZE"       )){prop_type = PTYPE_UINT; prop_num = CL_DEVICE_QUEUE_ON_DEVICE_MAX_SIZE       ;}
-        // if (!strcmp(prop_name, "CL_DEVICE_QUEUE_ON_DEVICE_PREFERRED_SIZE" )){prop_type = PTYPE_UINT; prop_num = CL_DEVICE_QUEUE_ON_DEVICE_PREFERRED_SIZE ;}
-        
-        // extract data into a new variable
-        mxArray * mw_info;
-        switch (prop_type){
-            case PTYPE_ULNG:{
-                mw_info = mxCreateUninitNumericMatrix(1,1,mxUINT64_CLASS, mxREAL);
-                (devs[i]).getInfo(prop_num, (uint64_t *) mxGetUint64s(mw_info)); // load 
-                } break;
-            case PTYPE_SIZT:{
-                mw_info = mxCreateUninitNumericMatrix(1,1,mxUINT64_CLASS, mxREAL);
-                (devs[i]).getInfo(prop_num, (uint64_t *) mxGetUint64s(mw_info)); // load 
-                } break;
-            case PTYPE_UINT:{
-                mw_info = mxCreateUninitNumericMatrix(1,1,mxUINT32_CLASS, mxREAL);
-                (devs[i]).getInfo(prop_num, (uint32_t *) mxGetUint32s(mw_info)); // load 
-                } break;
-            case PTYPE_BOOL:{
-                cl_bool tf;
-                (devs[i]).getInfo(prop_num, &tf); // load 
-                mw_info = mxCreateLogicalScalar(tf); // store
-                } break;
-            case PTYPE_SZTA:{
-                std::vector<size_t> tmp_size; // array of size_t values
-                (devs[i]).getInfo(prop_num, &tmp_size); // load
-                mw_info = mxCreateNumericMatrix(1,tmp_size.size(),mxUINT64_CLASS, mxREAL);
-                uint64_t * x = (uint64_t *) mxGetData(mw_info);
-                for(int k = 0; k < tmp_size.size(); ++k) {x[k] = tmp_size[k];}
-                } break;
-            case PTYPE_CHAR:{
-                std::string txt;
-                (devs[i]).getInfo(prop_num, &txt); // load 
-                mw_info = mxCreateString(txt.c_str());
-                } break;
-            case PTYPE_DEVC:{
-                cl_device_type id;
-                (devs[i]).getInfo(prop_num, (cl_device_id *) &id); // load 
-                std::string txt="";
-                if (id == CL_DEVICE_TYPE_CPU        ) {txt += "cpu | ";}
-                if (id == CL_DEVICE_TYPE_GPU        ) {txt += "gpu | ";}
-                if (id == CL_DEVICE_TYPE_ACCELERATOR) {txt += "accelerator | ";}
-                if (id == CL_DEVICE_TYPE_DEFAULT    ) {txt += "default | ";}
-                if (id == CL_DEVICE_TYPE_CUSTOM     ) {txt += "custom | ";}
-                txt.erase(txt.length() - 3); // delete separators at the end
-                mw_info = mxCreateString(txt.c_str()); // pass string to MATLAB
-                } break;
-            default:{
-                // not enumerated -> empty double
-                // mexPrintf("No data has been placed."); // DEBUG
-                mw_info = mxCreateNumericMatrix(0,0,mxDOUBLE_CLASS,mxREAL);
-                } break;
-        }
-
-        // prop_type ? mexPrintf("Found matching type.\n") : mexPrintf("No matching type found.\n"); // DEBUG
-
         // store each data within the cell
-        mxSetCell(cell_array_ptr, j + i * num_props, mxDuplicateArray(mw_info));
+        mxSetCell(cell_array_ptr, j + i * num_props, propToMx(staged[i][j], props[j].type));
     } // each property
   } // each device
  
- 
   // set output
   plhs[0] = cell_array_ptr;
 
-  // mexPrintf("Done!\n"); // DEBUG
-
   return;
 }
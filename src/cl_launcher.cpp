@@ -0,0 +1,630 @@
+/* This project is licensed under the terms of the Creative Commons CC
+ * BY-NC 4.0 license. */
+
+// Persistent OpenCL launcher: one context and in-order command queue per
+// device, and a registry of built programs (and their kernels), all kept
+// alive across calls so that a launch is only argument setup and enqueue.
+
+#include "matrix.h"
+#include "mex.h"
+#include "tmwtypes.h"
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ocl_device_list.hpp" // device cache (shared with cl_get_device_info)
+#include "ocl_program_cache.hpp" // on-disk program binaries
+
+// per-device context and queue (created on first use)
+struct DeviceQueue {
+  cl::Context context;
+  cl::CommandQueue queue;
+};
+
+// a build on a worker thread (no mx calls) - joined before release
+struct PendingBuild {
+  std::thread worker;
+  cl_program program = NULL; // NULL on failure
+  std::string msg; // reason for failure
+  bool cached = false;
+  std::string args; // kernel argument metadata (see programArgInfo)
+  std::atomic<bool> done{false}; // the worker has finished (see 'ready')
+  ~PendingBuild() {
+    if (worker.joinable()) worker.join();
+    if (program) clReleaseProgram(program);
+  }
+};
+
+// a built (or building) program and its kernels (created on first launch)
+struct ProgramEntry {
+  size_t device; // 1-based device index
+  std::string key; // device | source | options
+  std::string fp; // fingerprint of the source and header contents
+  cl::Program program;
+  std::shared_ptr<PendingBuild> pending; // until waited on
+  bool cached; // loaded from the binary cache
+  size_t refs = 0; // 'build' calls not yet released (the handle is shared by key)
+  std::vector<std::string> names; // kernel names
+  std::map<std::string, std::vector<ArgInfo> > args; // argument metadata per kernel (if available)
+  std::map<std::string, cl::Kernel> kernels;
+};
+
+// process-lifetime registries: the handle of a program is its index + 1,
+// offset by the generation of the program registry, so that the handles of
+// a released registry (or of the mex-file before a clear) are rejected
+static std::vector<DeviceQueue> * ocl_queues = NULL;
+static std::vector<ProgramEntry> * ocl_programs = NULL;
+static uint32_t ocl_generation = 0;
+static const double OCL_SLOTS = 1048576.0; // programs per generation (2^20)
+
+// program registry (created on first use, with a new generation): the
+// first generation is random, as a cleared mex-file restarts the count
+std::vector<ProgramEntry> & getPrograms(){
+  static uint32_t g = (uint32_t) std::random_device()() ^ (uint32_t) std::chrono::system_clock::now().time_since_epoch().count();
+  if (!ocl_programs) {
+    g = (g + 1) & 0x7FFFFFFF; // 31 bits: handles are exact doubles
+    ocl_generation = g ? g : 1;
+    ocl_programs = new std::vector<ProgramEntry>();
+  }
+  return *ocl_programs;
+}
+
+// handle of the program in slot k
+double programHandle(size_t k){
+  return ocl_generation * OCL_SLOTS + (double) (k + 1);
+}
+
+void releaseLauncher(){
+  delete ocl_programs; // kernels and programs before their contexts
+  delete ocl_queues;
+  ocl_programs = NULL;
+  ocl_queues = NULL;
+  releaseOclDevices();
+}
+
+// context and queue of a device (NULL if the device is invalid)
+DeviceQueue * getDeviceQueue(size_t idx){
+  std::vector<cl::Device> const& devs = getOclDevices();
+  if (idx < 1 || idx > devs.size()) return NULL;
+  if (!ocl_queues) ocl_queues = new std::vector<DeviceQueue>();
+  if (ocl_queues->size() < devs.size()) ocl_queues->resize(devs.size()); // sub-devices are appended
+
+  DeviceQueue & q = (*ocl_queues)[idx - 1];
+  if (!q.queue()) {
+    const cl_device_id d = devs[idx - 1]();
+    cl_platform_id p;
+    if (clGetDeviceInfo(d, CL_DEVICE_PLATFORM, sizeof(p), &p, NULL) != CL_SUCCESS) return NULL;
+    const cl_context_properties props[] = {CL_CONTEXT_PLATFORM, (cl_context_properties) p, 0};
+
+    cl_int err;
+    const cl_context ctx = clCreateContext(props, 1, &d, NULL, NULL, &err);
+    if (err != CL_SUCCESS) return NULL;
+    q.context = cl::Context(ctx); // takes ownership
+    const cl_command_queue cq = clCreateCommandQueue(ctx, d, 0, &err);
+    if (err != CL_SUCCESS) return NULL;
+    q.queue = cl::CommandQueue(cq);
+  }
+  return &q;
+}
+
+// registered program by handle (NULL if invalid, released, or of another
+// generation)
+ProgramEntry * getProgram(double h){
+  if (!ocl_programs || h < 1 || h != floor(h) || floor(h / OCL_SLOTS) != ocl_generation) return NULL;
+  const size_t k = (size_t) (h - ocl_generation * OCL_SLOTS);
+  if (k < 1 || k > ocl_programs->size()) return NULL;
+  ProgramEntry & e = (*ocl_programs)[k - 1];
+  return (e.program() || e.pending) ? &e : NULL;
+}
+
+// contents of a file
+bool readSource(const char * path, std::string & src){
+  std::ifstream f(path, std::ios::binary);
+  if (!f) return false;
+  std::stringstream ss;
+  ss << f.rdbuf();
+  src = ss.str();
+  return true;
+}
+
+// concurrent builds are limited to the number of hardware threads, as
+// vendor compilers may themselves be multi-threaded
+struct BuildSlot {
+  static std::mutex & mtx() { static std::mutex m; return m; }
+  static std::condition_variable & cv() { static std::condition_variable c; return c; }
+  static unsigned & active() { static unsigned n = 0; return n; }
+  BuildSlot() {
+    const unsigned cap = std::max(1u, std::thread::hardware_concurrency());
+    std::unique_lock<std::mutex> lock(mtx());
+    cv().wait(lock, [cap]{ return active() < cap; });
+    ++active();
+  }
+  ~BuildSlot() {
+    { std::lock_guard<std::mutex> lock(mtx()); --active(); }
+    cv().notify_one();
+  }
+};
+
+void buildWorker(PendingBuild * b, cl_context ctx, cl_device_id d, std::string src, std::string deps, std::string opts, std::string dir,
+    bool il, std::vector<SpecConstant> specs){
+  BuildSlot slot;
+  b->program = buildCachedProgram(ctx, d, src, deps, opts, dir, b->msg, &b->cached, il, specs, &b->args);
+  b->done = true;
+}
+
+// start building a program for a device, through the binary cache in dir
+// (if not empty), on a worker thread if async - returns an error message on
+// failure to start. deps are the contents of the headers included by the
+// source (see headerContents). If il, src is a SPIR-V module.
+std::string startBuild(size_t dev, std::string const& src, std::string const& deps, std::string const& opts, std::string const& dir, bool async, ProgramEntry & e,
+    bool il = false, std::vector<SpecConstant> const& specs = std::vector<SpecConstant>()){
+  DeviceQueue * q = getDeviceQueue(dev); // contexts are created on this thread
+  if (!q) return "Unable to create a context on device " + std::to_string(dev) + ".";
+  const cl_device_id d = getOclDevices()[dev - 1]();
+
+  std::shared_ptr<PendingBuild> b = std::make_shared<PendingBuild>();
+  if (async) b->worker = std::thread(buildWorker, b.get(), q->context(), d, src, deps, opts, dir, il, specs);
+  else buildWorker(b.get(), q->context(), d, src, deps, opts, dir, il, specs);
+
+  // replace the entry
+  e.device = dev;
+  e.program = cl::Program();
+  e.pending = b;
+  e.cached = false;
+  e.kernels.clear();
+  e.names.clear();
+  e.args.clear();
+  return "";
+}
+
+// wait for the build of a program - returns an error message on failure,
+// after which the program is no longer registered
+std::string finishBuild(ProgramEntry & e){
+  if (!e.pending) return "";
+  std::shared_ptr<PendingBuild> b = e.pending;
+  e.pending.reset();
+  if (b->worker.joinable()) b->worker.join();
+  if (!b->program) { e.key.clear(); return b->msg; }
+  e.program = cl::Program(b->program); // takes ownership
+  e.cached = b->cached;
+  b->program = NULL;
+
+  // kernel names (';' separated)
+  size_t sz = 0;
+  clGetProgramInfo(e.program(), CL_PROGRAM_KERNEL_NAMES, 0, NULL, &sz);
+  std::string names(sz, '\0');
+  if (sz) clGetProgramInfo(e.program(), CL_PROGRAM_KERNEL_NAMES, sz, &names[0], NULL);
+  std::stringstream ss(names.c_str());
+  for (std::string nm; std::getline(ss, nm, ';');) if (!nm.empty()) e.names.push_back(nm);
+
+  // argument metadata (empty if unavailable)
+  for (std::string const& nm : e.names) {
+    std::vector<ArgInfo> info = kernelArgInfo(b->args, nm);
+    if (!info.empty()) e.args[nm] = info;
+  }
+  return "";
+}
+
+// kernel argument: host data, size in bytes, passed by value or as a
+// buffer, the host destination of a buffer's contents (if an output), and
+// whether it is local memory of that size (the data is unused)
+struct KernelArg {
+  const void * data;
+  size_t bytes;
+  bool byValue;
+  void * out;
+  bool local;
+};
+
+// launch a kernel and wait for its outputs - returns an error message on failure
+std::string launchKernel(ProgramEntry & e, const char * name, const size_t * offset, const size_t * global, const size_t * local, std::vector<KernelArg> const& args){
+  DeviceQueue * q = getDeviceQueue(e.device);
+  if (!q) return "Device " + std::to_string(e.device) + " is no longer available.";
+
+  // wait for the build
+  const std::string msg = finishBuild(e);
+  if (!msg.empty()) return msg;
+
+  // kernel (created on first launch)
+  cl_int err;
+  std::map<std::string, cl::Kernel>::iterator it = e.kernels.find(name);
+  if (it == e.kernels.end()) {
+    const cl_kernel k = clCreateKernel(e.program(), name, &err);
+    if (err != CL_SUCCESS) return "The kernel '" + std::string(name) + "' was not found in the program.";
+    it = e.kernels.insert(std::make_pair(std::string(name), cl::Kernel(k))).first;
+  }
+  const cl_kernel k = it->second();
+
+  // arguments (buffers are released on return)
+  std::vector<cl::Buffer> bufs(args.size());
+  for (size_t i = 0; i < args.size(); ++i) {
+    KernelArg const& a = args[i];
+    if (a.local) {
+      err = clSetKernelArg(k, (cl_uint) i, std::max(a.bytes, (size_t) 1), NULL);
+    } else if (a.byValue) {
+      err = clSetKernelArg(k, (cl_uint) i, a.bytes, a.data);
+    } else {
+      const cl_mem_flags f = (a.out ? CL_MEM_READ_WRITE : CL_MEM_READ_ONLY) | (a.bytes ? CL_MEM_COPY_HOST_PTR : 0);
+      const cl_mem m = clCreateBuffer(q->context(), f, std::max(a.bytes, (size_t) 1), a.bytes ? (void *) a.data : NULL, &err);
+      if (err != CL_SUCCESS) return "Unable to allocate argument " + std::to_string(i + 1) + " (" + std::to_string(err) + ").";
+      bufs[i] = cl::Buffer(m);
+      err = clSetKernelArg(k, (cl_uint) i, sizeof(cl_mem), &m);
+    }
+    if (err != CL_SUCCESS) return "Unable to set argument " + std::to_string(i + 1) + " (" + std::to_string(err) + ").";
+  }
+
+  // enqueue, then read back the outputs
+  err = clEnqueueNDRangeKernel(q->queue(), k, 3, offset, global, local, 0, NULL, NULL);
+  if (err != CL_SUCCESS) return "clEnqueueNDRangeKernel failed (" + std::to_string(err) + ").";
+  for (size_t i = 0; i < args.size(); ++i) {
+    if (args[i].out && args[i].bytes) {
+      err = clEnqueueReadBuffer(q->queue(), bufs[i](), CL_FALSE, 0, args[i].bytes, args[i].out, 0, NULL, NULL);
+      if (err != CL_SUCCESS) {
+        clFinish(q->queue()); // pending reads target the host arrays
+        return "Unable to read argument " + std::to_string(i + 1) + " (" + std::to_string(err) + ").";
+      }
+    }
+  }
+  err = clFinish(q->queue());
+  if (err != CL_SUCCESS) return "Kernel execution failed (" + std::to_string(err) + ").";
+  return "";
+}
+
+// cellstr from strings
+mxArray * mxCellstr(std::vector<std::string> const& s){
+  mxArray * c = mxCreateCellMatrix(1, s.size());
+  for (size_t i = 0; i < s.size(); ++i) mxSetCell(c, i, mxCreateString(s[i].c_str()));
+  return c;
+}
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+
+    // input:  'build', device index, file name, options (, cache folder (, async (, {headers})))
+    // output: program handle, {kernel names}, whether loaded from the cache
+    //         (if async, the build continues on a worker thread and the
+    //         names are empty: see 'wait'). A registered program is reused
+    //         if its source and headers are unchanged. Each call holds a
+    //         reference to the program until it is released.
+    //
+    // input:  'build_source', device index, source text, options (, ...)
+    // output: as for 'build': the program is compiled from memory, and
+    //         identical sources share a program (keyed by content)
+    //
+    // input:  'build_il', device index, SPIR-V file name, options (, cache
+    //         folder (, async (, {}, (spec ids, {spec values})))))
+    // output: as for 'build', for a device reporting CL_DEVICE_IL_VERSION.
+    //         Specialization constants take the size of their value's class.
+    //
+    // input:  'wait', program handle
+    // output: {kernel names}, whether loaded from the cache
+    //
+    // input:  'ready', program handle
+    // output: whether the program is built - does not wait (fails as
+    //         'wait' does if the build failed)
+    //
+    // input:  'args', program handle, kernel name
+    // output: argument metadata from the driver (struct array with fields
+    //         address, access, qualifier, type, name), or 1x0 if unavailable
+    //
+    // input:  'launch', program handle, kernel name, [offset, global size],
+    //         local size, arguments ..., read-only flags
+    // output: arguments that are not read-only, after execution
+    //         (non-pointer arguments are passed by value, global and
+    //         constant pointers by buffer, and local pointers as the size
+    //         of their argument in bytes - without argument metadata,
+    //         read-only scalars are passed by value, all else by buffer)
+    //
+    // input:  'release' (, program handle) - release one reference to a
+    //         program (freed with its last reference), or every program
+    // input:  'count'   - output: number of devices
+    // input:  'refresh' - release everything and re-enumerate the devices
+    // input:  'partition', device index, mode, values (see cl_get_device_info)
+    // output: indices of the new sub-devices
+
+  // release with the mex-file
+  mexAtExit(releaseLauncher);
+
+  if(nrhs < 1 || !mxIsChar(prhs[0])){
+    mexErrMsgIdAndTxt("MatCL:cl_launcher:InvalidInput",
+           "The first input must be a command: 'build', 'build_source', 'build_il', 'wait', 'ready', 'args', 'launch', 'release', 'count', 'refresh', or 'partition'.");
+    return;
+  }
+  char * c = mxArrayToString(prhs[0]);
+  const std::string cmd(c);
+  mxFree(c);
+
+  if (cmd == "launch") {
+    // validate
+    if(nrhs < 6 || !mxIsNumeric(prhs[1]) || !mxIsChar(prhs[2])
+      || mxGetNumberOfElements(prhs[3]) != 6 || mxGetNumberOfElements(prhs[4]) != 3
+      || (int) mxGetNumberOfElements(prhs[nrhs-1]) != nrhs - 6){
+      mexErrMsgIdAndTxt("MatCL:cl_launcher:InvalidLaunch",
+             "Usage: cl_launcher('launch', handle, kernel, [offset, global], local, args..., ro).");
+      return;
+    }
+    ProgramEntry * e = getProgram(mxGetScalar(prhs[1]));
+    if(!e){
+      mexErrMsgIdAndTxt("MatCL:cl_launcher:InvalidHandle", "The program handle is invalid or has been released.");
+      return;
+    }
+    const std::string berr = finishBuild(*e); // argument metadata is known once built
+    if(!berr.empty()){
+      mexErrMsgIdAndTxt("MatCL:cl_launcher:BuildFailed", "%s", berr.c_str());
+      return;
+    }
+    char * k = mxArrayToString(prhs[2]);
+    const std::string name(k);
+    mxFree(k);
+    const std::map<std::string, std::vector<ArgInfo> >::const_iterator ai = e->args.find(name);
+    const std::vector<ArgInfo> * info = ai == e->args.end() ? NULL : &ai->second;
+    if(info && (int) info->size() != nrhs - 6){
+      mexErrMsgIdAndTxt("MatCL:cl_launcher:InvalidLaunch", "The kernel '%s' takes %d arguments, but %d were given.",
+             name.c_str(), (int) info->size(), nrhs - 6);
+      return;
+    }
+
+    // ranges (as double)
+    mxArray * r[3] = {NULL, NULL, NULL};
+    mexCallMATLAB(1, &r[0], 1, (mxArray **) &prhs[3], "double");
+    mexCallMATLAB(1, &r[1], 1, (mxArray **) &prhs[4], "double");
+    mexCallMATLAB(1, &r[2], 1, (mxArray **) &prhs[nrhs-1], "double");
+    size_t offset[3], global[3], local[3];
+    bool autolocal = false; // let the driver choose
+    for (int i = 0; i < 3; ++i) {
+      offset[i] = (size_t) mxGetDoubles(r[0])[i];
+      global[i] = (size_t) mxGetDoubles(r[0])[i+3];
+      local [i] = (size_t) mxGetDoubles(r[1])[i];
+      autolocal |= !local[i];
+    }
+
+    // arguments: by value, by buffer, or as local memory as declared (or
+    // read-only scalars by value), and outputs of those not by buffer are
+    // copies
+    const int narg = nrhs - 6;
+    std::vector<KernelArg> args(narg);
+    std::vector<mxArray *> outs;
+    for (int i = 0; i < narg; ++i) {
+      const mxArray * x = prhs[5+i];
+      if(!mxIsNumeric(x) || mxIsComplex(x) || mxIsSparse(x)){
+        for (mxArray * a : r) mxDestroyArray(a);
+        for (mxArray * y : outs) mxDestroyArray(y);
+        mexErrMsgIdAndTxt("MatCL:cl_launcher:InvalidArgument", "Argument %d must be a real, full, numeric array.", i+1);
+        return;
+      }
+      const bool ro = mxGetDoubles(r[2])[i] != 0;
+      const bool local = info && (*info)[i].local();
+      const bool byValue = info ? !(*info)[i].buffer() && !local : ro && mxIsScalar(x);
+      args[i] = {mxGetData(x), mxGetNumberOfElements(x) * mxGetElementSize(x), byValue, NULL, local};
+      if (!ro) {
+        const bool buf = !byValue && !local;
+        mxArray * y = !buf ? mxDuplicateArray(x)
+            : mxCreateUninitNumericArray(mxGetNumberOfDimensions(x), (size_t *) mxGetDimensions(x), mxGetClassID(x), mxREAL);
+        if (buf) args[i].out = mxGetData(y);
+        outs.push_back(y);
+      }
+    }
+    for (mxArray * a : r) mxDestroyArray(a);
+
+    const std::string err = launchKernel(*e, name.c_str(), offset, global, autolocal ? NULL : local, args);
+
+    // return the requested outputs
+    for (size_t i = 0; i < outs.size(); ++i) {
+      if (err.empty() && (int) i < std::max(nlhs, 1)) plhs[i] = outs[i];
+      else mxDestroyArray(outs[i]);
+    }
+    if(!err.empty()){
+      mexErrMsgIdAndTxt("MatCL:cl_launcher:LaunchFailed", "%s", err.c_str());
+    }
+    return;
+  }
+
+  if (cmd == "build" || cmd == "build_source" || cmd == "build_il") {
+    const bool text = cmd == "build_source"; // source text, not a file name
+    const bool il = cmd == "build_il"; // SPIR-V module
+    if(nrhs < 4 || !mxIsNumeric(prhs[1]) || !mxIsScalar(prhs[1]) || !mxIsChar(prhs[2]) || !mxIsChar(prhs[3])){
+      mexErrMsgIdAndTxt("MatCL:cl_launcher:InvalidBuild",
+             "Usage: cl_launcher('%s', device, %s, options, cachedir, async, headers%s).", cmd.c_str(),
+             text ? "source" : "filename", il ? ", specids, specvalues" : "");
+      return;
+    }
+    const size_t dev = (size_t) mxGetScalar(prhs[1]);
+    char * f = mxArrayToString(prhs[2]);
+    char * o = mxArrayToString(prhs[3]);
+    char * c = (nrhs > 4 && mxIsChar(prhs[4])) ? mxArrayToString(prhs[4]) : NULL;
+    const std::string file(f), opts(o), dir(c ? c : "");
+    mxFree(f);
+    mxFree(o);
+    if (c) mxFree(c);
+
+    std::string src;
+    if (text) src = file;
+    else if(!readSource(file.c_str(), src)){
+      mexErrMsgIdAndTxt("MatCL:cl_launcher:FileNotFound", "Unable to read %s.", file.c_str());
+      return;
+    }
+
+    const bool async = nrhs > 5 && mxIsScalar(prhs[5]) && mxGetScalar(prhs[5]) != 0;
+    std::vector<std::string> hdrs; // included headers (for the cache key)
+    for (mwIndex i = 0; nrhs > 6 && mxIsCell(prhs[6]) && i < mxGetNumberOfElements(prhs[6]); ++i) {
+      char * hdr = mxArrayToString(mxGetCell(prhs[6], i));
+      if (hdr) { hdrs.push_back(hdr); mxFree(hdr); }
+    }
+
+    // specialization constants (IL only)
+    std::vector<SpecConstant> specs;
+    if (il && nrhs > 8 && mxIsNumeric(prhs[7]) && mxIsCell(prhs[8]) && mxGetNumberOfElements(prhs[7]) == mxGetNumberOfElements(prhs[8])) {
+      mxArray * ids = NULL; // as double
+      mexCallMATLAB(1, &ids, 1, (mxArray **) &prhs[7], "double");
+      for (mwIndex i = 0; i < mxGetNumberOfElements(prhs[8]); ++i) {
+        const mxArray * v = mxGetCell(prhs[8], i);
+        if (!v || !mxIsScalar(v) || mxIsComplex(v) || !(mxIsNumeric(v) || mxIsLogical(v))) {
+          mxDestroyArray(ids);
+          mexErrMsgIdAndTxt("MatCL:cl_launcher:InvalidBuild", "Specialization constant %d must be a real numeric or logical scalar.", (int) i + 1);
+          return;
+        }
+        const unsigned char * x = (const unsigned char *) mxGetData(v);
+        specs.push_back({(cl_uint) mxGetDoubles(ids)[i], std::vector<unsigned char>(x, x + mxGetElementSize(v))});
+      }
+      mxDestroyArray(ids);
+    }
+
+    // rebuild in place if registered, so that handles remain valid: a
+    // program is not rebuilt if neither its source nor its headers changed
+    std::vector<ProgramEntry> & progs = getPrograms();
+    const std::string key = std::to_string(dev) + "|" + (text ? "#" + hex64(fnv1a(src)) : file) + "|" + opts;
+    const std::string deps = headerContents(hdrs) + specContents(specs);
+    const std::string fp = hex64(fnv1a(src)) + hex64(fnv1a(deps));
+    size_t h = 0;
+    while (h < progs.size() && progs[h].key != key) ++h;
+    if (h + 1 >= OCL_SLOTS){
+      mexErrMsgIdAndTxt("MatCL:cl_launcher:TooManyPrograms", "Too many programs have been built: release them with cl_launcher('release').");
+      return;
+    }
+    if (h == progs.size()) progs.push_back(ProgramEntry());
+    ProgramEntry & e = progs[h];
+    std::string err;
+    if (e.fp != fp || !(e.program() || e.pending)) {
+      if (e.pending) finishBuild(e); // superseded
+      err = startBuild(dev, src, deps, opts, dir, async, e, il, specs);
+    }
+    if (err.empty()) { e.key = key; e.fp = fp; }
+    if (err.empty() && !async) err = finishBuild(e);
+    if (err.empty()) ++e.refs;
+    if(!err.empty()){
+      mexErrMsgIdAndTxt("MatCL:cl_launcher:BuildFailed", "%s", err.c_str());
+      return;
+    }
+
+    plhs[0] = mxCreateDoubleScalar(programHandle(h));
+    if (nlhs > 1) plhs[1] = mxCellstr(e.names);
+    if (nlhs > 2) plhs[2] = mxCreateLogicalScalar(e.cached);
+    return;
+  }
+
+  if (cmd == "ready") {
+    ProgramEntry * e = (nrhs > 1 && mxIsNumeric(prhs[1])) ? getProgram(mxGetScalar(prhs[1])) : NULL;
+    if(!e){
+      mexErrMsgIdAndTxt("MatCL:cl_launcher:InvalidHandle", "The program handle is invalid or has been released.");
+      return;
+    }
+    const bool ready = !e->pending || e->pending->done;
+    const std::string err = ready ? finishBuild(*e) : "";
+    if(!err.empty()){
+      mexErrMsgIdAndTxt("MatCL:cl_launcher:BuildFailed", "%s", err.c_str());
+      return;
+    }
+    plhs[0] = mxCreateLogicalScalar(ready);
+    return;
+  }
+
+  if (cmd == "wait") {
+    ProgramEntry * e = (nrhs > 1 && mxIsNumeric(prhs[1])) ? getProgram(mxGetScalar(prhs[1])) : NULL;
+    if(!e){
+      mexErrMsgIdAndTxt("MatCL:cl_launcher:InvalidHandle", "The program handle is invalid or has been released.");
+      return;
+    }
+    const std::string err = finishBuild(*e);
+    if(!err.empty()){
+      mexErrMsgIdAndTxt("MatCL:cl_launcher:BuildFailed", "%s", err.c_str());
+      return;
+    }
+    plhs[0] = mxCellstr(e->names);
+    if (nlhs > 1) plhs[1] = mxCreateLogicalScalar(e->cached);
+    return;
+  }
+
+  if (cmd == "args") {
+    ProgramEntry * e = (nrhs > 2 && mxIsNumeric(prhs[1]) && mxIsChar(prhs[2])) ? getProgram(mxGetScalar(prhs[1])) : NULL;
+    if(!e){
+      mexErrMsgIdAndTxt("MatCL:cl_launcher:InvalidHandle", "The program handle is invalid or has been released.");
+      return;
+    }
+    const std::string err = finishBuild(*e);
+    if(!err.empty()){
+      mexErrMsgIdAndTxt("MatCL:cl_launcher:BuildFailed", "%s", err.c_str());
+      return;
+    }
+    char * k = mxArrayToString(prhs[2]);
+    const std::map<std::string, std::vector<ArgInfo> >::const_iterator ai = e->args.find(k);
+    mxFree(k);
+    const size_t n = ai == e->args.end() ? 0 : ai->second.size();
+    const char * fields[] = {"address", "access", "qualifier", "type", "name"};
+    plhs[0] = mxCreateStructMatrix(1, n, 5, fields);
+    for (size_t i = 0; i < n; ++i) {
+      ArgInfo const& a = ai->second[i];
+      mxSetField(plhs[0], i, "address"  , mxCreateString(a.address.c_str()));
+      mxSetField(plhs[0], i, "access"   , mxCreateString(a.access.c_str()));
+      mxSetField(plhs[0], i, "qualifier", mxCreateString(a.qualifier.c_str()));
+      mxSetField(plhs[0], i, "type"     , mxCreateString(a.type.c_str()));
+      mxSetField(plhs[0], i, "name"     , mxCreateString(a.name.c_str()));
+    }
+    return;
+  }
+
+  if (cmd == "release") {
+    if (nrhs > 1) {
+      ProgramEntry * e = getProgram(mxGetScalar(prhs[1]));
+      if (e && e->refs > 1) --e->refs; // still in use
+      else if (e) *e = ProgramEntry(); // keep the slot
+    } else {
+      delete ocl_programs;
+      ocl_programs = NULL;
+    }
+    return;
+  }
+
+  if (cmd == "count") {
+    plhs[0] = mxCreateDoubleScalar((double) getOclDevices().size());
+    return;
+  }
+
+  if (cmd == "refresh") {
+    releaseLauncher();
+    plhs[0] = mxCreateDoubleScalar((double) getOclDevices().size());
+    return;
+  }
+
+  if (cmd == "partition") {
+    if(nrhs < 4 || !mxIsNumeric(prhs[1]) || !mxIsScalar(prhs[1]) || !mxIsChar(prhs[2])){
+      mexErrMsgIdAndTxt("MatCL:cl_launcher:InvalidPartition",
+             "Usage: cl_launcher('partition', index, mode, values).");
+      return;
+    }
+    const size_t idx = (size_t) mxGetScalar(prhs[1]);
+    char * mode = mxArrayToString(prhs[2]);
+    char * dom = mxIsChar(prhs[3]) ? mxArrayToString(prhs[3]) : NULL;
+    std::vector<double> vals;
+    if (mxIsNumeric(prhs[3])) {
+      mxArray * v = NULL; // values as double
+      mexCallMATLAB(1, &v, 1, (mxArray **) &prhs[3], "double");
+      vals.assign(mxGetDoubles(v), mxGetDoubles(v) + mxGetNumberOfElements(v));
+      mxDestroyArray(v);
+    }
+    const std::vector<size_t> inds = partitionOclDevice(idx, partitionProperties(mode, vals, dom));
+    if (dom) mxFree(dom);
+    mxFree(mode);
+    if(inds.empty()){
+      mexErrMsgIdAndTxt("MatCL:cl_launcher:PartitionFailed", "Device %d could not be partitioned as requested.", (int) idx);
+      return;
+    }
+    plhs[0] = mxCreateDoubleMatrix(1, inds.size(), mxREAL);
+    for (size_t k = 0; k < inds.size(); ++k) {mxGetDoubles(plhs[0])[k] = (double) inds[k];}
+    return;
+  }
+
+  mexErrMsgIdAndTxt("MatCL:cl_launcher:UnknownCommand",
+         "Unknown command '%s'. The supported commands are 'build', 'build_source', 'build_il', 'wait', 'ready', 'args', 'launch', 'release', 'count', 'refresh', and 'partition'.", cmd.c_str());
+}
@@ -0,0 +1,199 @@
+/* This project is licensed under the terms of the Creative Commons CC
+ * BY-NC 4.0 license. */
+
+// Offline precompiler: builds OpenCL C files (or SPIR-V modules) for every
+// visible device and stores the binaries in the program cache read by
+// oclKernel and oclProgram (see ocl_program_cache.hpp), so that jobs start
+// with every kernel already built.
+//
+// usage: cl_precompile [-c cachedir] -o options [-o options]... [-d device]... file...
+//   -c  cache folder (default: $MATLAB_OPENCL_CACHE/programs), created if
+//       needed
+//   -o  an option set (required): one build per file, device, and option
+//       set. This must match the options of the build, i.e. the
+//       build_settings of the kernel (e.g. "-I/path/to/kernels -DWIDTH=512
+//       -cl-mad-enable"; by default "-cl-mad-enable
+//       -cl-fp32-correctly-rounded-divide-sqrt" with -I options for the
+//       folders of the headers included, if any)
+//   -d  (1-based) device index, as in oclDeviceTable (default: all)
+//
+// Entries are keyed by device name and driver version, so the cache must
+// be filled on nodes with the same devices and drivers as those that use it.
+// A program that cannot be written to the cache counts as a failure.
+//
+// N.B. no mx calls: build with compile_cl_precompile, or directly e.g.
+// g++ -std=c++11 -O2 cl_precompile.cpp -I../sub/MatCL/src -lOpenCL -pthread -ldl -o cl_precompile
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#define mkdir(d, m) _mkdir(d)
+#endif
+
+#include "ocl_device_list.hpp" // device cache (same order as the mex-files)
+#include "ocl_program_cache.hpp" // on-disk program binaries
+
+// contents of a file
+static bool readFile(std::string const& path, std::string & src){
+  std::ifstream f(path.c_str(), std::ios::binary);
+  if (!f) return false;
+  std::stringstream ss;
+  ss << f.rdbuf();
+  src = ss.str();
+  return true;
+}
+
+// folder of a file ("." if none)
+static std::string folderOf(std::string const& path){
+  const size_t k = path.find_last_of("/\\");
+  return k == std::string::npos ? "." : path.substr(0, k);
+}
+
+// names in the #include directives of a source
+static std::vector<std::string> includeNames(std::string const& src){
+  std::vector<std::string> names;
+  std::stringstream ss(src);
+  for (std::string ln; std::getline(ss, ln);) {
+    size_t k = ln.find_first_not_of(" \t");
+    if (k == std::string::npos || ln[k] != '#') continue;
+    k = ln.find_first_not_of(" \t", k + 1);
+    if (k == std::string::npos || ln.compare(k, 7, "include")) continue;
+    k = ln.find_first_not_of(" \t", k + 7);
+    if (k == std::string::npos || (ln[k] != '<' && ln[k] != '"')) continue;
+    const size_t e = ln.find_first_of(">\"", k + 1);
+    if (e != std::string::npos && e > k + 1) names.push_back(ln.substr(k + 1, e - k - 1));
+  }
+  return names;
+}
+
+// headers included by a file, recursively: each is searched for in the
+// including file's folder, then in the -I folders of the options (as in
+// oclKernel.resolveIncludes)
+static std::vector<std::string> resolveIncludes(std::string const& file, std::string const& opts){
+  std::vector<std::string> search, hdrs, todo(1, file);
+  std::stringstream ss(opts);
+  for (std::string o; ss >> o;) if (!o.compare(0, 2, "-I") && o.size() > 2) search.push_back(o.substr(2));
+
+  while (!todo.empty()) {
+    const std::string f = todo.front();
+    todo.erase(todo.begin());
+    std::string src;
+    if (!readFile(f, src)) continue;
+    std::vector<std::string> cand(1, folderOf(f));
+    cand.insert(cand.end(), search.begin(), search.end());
+    for (std::string const& n : includeNames(src)) {
+      for (std::string const& c : cand) {
+        const std::string h = c + "/" + n;
+        if (!std::ifstream(h.c_str())) continue;
+        if (std::find(hdrs.begin(), hdrs.end(), h) == hdrs.end()) { hdrs.push_back(h); todo.push_back(h); }
+        break;
+      }
+    }
+  }
+  return hdrs;
+}
+
+// create a folder and its parents - false if it does not exist on return
+static bool makeDirs(std::string const& dir){
+  for (size_t k = dir.find_first_of("/\\", 1); k != std::string::npos; k = dir.find_first_of("/\\", k + 1)) {
+    mkdir(dir.substr(0, k).c_str(), 0777); // if needed
+  }
+  mkdir(dir.c_str(), 0777);
+  struct stat st;
+  return !stat(dir.c_str(), &st) && (st.st_mode & S_IFDIR);
+}
+
+static bool endsWith(std::string const& s, const char * x){
+  const size_t n = strlen(x);
+  return s.size() >= n && !s.compare(s.size() - n, n, x);
+}
+
+int main(int argc, char ** argv){
+  // arguments
+  std::string dir;
+  std::vector<std::string> files, optsets;
+  std::vector<size_t> inds;
+  for (int i = 1; i < argc; ++i) {
+    const std::string a = argv[i];
+    if ((a == "-c" || a == "-o" || a == "-d") && i + 1 < argc) {
+      const std::string v = argv[++i];
+      if (a == "-c") dir = v;
+      if (a == "-o") optsets.push_back(v);
+      if (a == "-d") inds.push_back((size_t) atoi(v.c_str()));
+    } else if (a == "-h" || a == "--help" || a[0] == '-') {
+      fprintf(stderr, "usage: %s [-c cachedir] -o options [-o options]... [-d device]... file...\n", argv[0]);
+      return a[0] == '-' && a != "-h" && a != "--help" ? 2 : 0;
+    } else {
+      files.push_back(a);
+    }
+  }
+  if (dir.empty() && getenv("MATLAB_OPENCL_CACHE")) dir = std::string(getenv("MATLAB_OPENCL_CACHE")) + "/programs";
+  if (dir.empty() || files.empty() || optsets.empty()) {
+    fprintf(stderr, "usage: %s [-c cachedir] -o options [-o options]... [-d device]... file...\n", argv[0]);
+    if (optsets.empty()) fprintf(stderr, "The options (-o) must match the build_settings of the kernels.\n");
+    return 2;
+  }
+  if (!makeDirs(dir)) { fprintf(stderr, "Unable to create the cache folder %s.\n", dir.c_str()); return 1; }
+
+  // devices
+  std::vector<cl::Device> const& devs = getOclDevices();
+  if (inds.empty()) for (size_t k = 1; k <= devs.size(); ++k) inds.push_back(k);
+  for (size_t const& k : inds) {
+    if (k < 1 || k > devs.size()) { fprintf(stderr, "Invalid device index %d: there are %d devices.\n", (int) k, (int) devs.size()); return 2; }
+  }
+
+  // sources (headers are resolved per option set)
+  std::vector<std::string> srcs(files.size());
+  for (size_t i = 0; i < files.size(); ++i) {
+    if (!readFile(files[i], srcs[i])) { fprintf(stderr, "Unable to read %s.\n", files[i].c_str()); return 1; }
+  }
+
+  // build on each device concurrently (each builds its jobs in turn)
+  std::vector<std::string> logs(inds.size());
+  std::vector<int> fails(inds.size(), 0);
+  auto work = [&](size_t j){
+    const cl_device_id d = devs[inds[j] - 1]();
+    cl_platform_id p;
+    cl_int err = clGetDeviceInfo(d, CL_DEVICE_PLATFORM, sizeof(p), &p, NULL);
+    const cl_context_properties props[] = {CL_CONTEXT_PLATFORM, (cl_context_properties) p, 0};
+    const cl_context ctx = err == CL_SUCCESS ? clCreateContext(props, 1, &d, NULL, NULL, &err) : NULL;
+    const std::string dev = "[" + std::to_string(inds[j]) + "] " + deviceString(d, CL_DEVICE_NAME);
+    if (err != CL_SUCCESS) { logs[j] += dev + ": unable to create a context.\n"; ++fails[j]; return; }
+
+    for (size_t i = 0; i < files.size(); ++i) {
+      const bool il = endsWith(files[i], ".spv") || endsWith(files[i], ".spirv");
+      for (std::string const& opts : optsets) {
+        const std::string deps = il ? "" : headerContents(resolveIncludes(files[i], opts));
+        std::string msg;
+        bool cached = false, stored = false;
+        const cl_program prog = buildCachedProgram(ctx, d, srcs[i], deps, opts, dir, msg, &cached, il,
+            std::vector<SpecConstant>(), NULL, &stored);
+        logs[j] += dev + ": " + files[i] + (opts.empty() ? "" : " (" + opts + ")") + ": ";
+        if (!prog) { logs[j] += "FAILED\n" + msg + "\n"; ++fails[j]; continue; }
+        clReleaseProgram(prog);
+        if (!stored) { logs[j] += "FAILED\nBuilt, but unable to write the binary to " + dir + ".\n"; ++fails[j]; continue; }
+        logs[j] += cached ? "cached\n" : "built\n";
+      }
+    }
+    clReleaseContext(ctx);
+  };
+  std::vector<std::thread> workers;
+  for (size_t j = 0; j < inds.size(); ++j) workers.emplace_back(work, j);
+  for (std::thread & t : workers) t.join();
+
+  // report
+  int nfail = 0;
+  for (size_t j = 0; j < inds.size(); ++j) { fputs(logs[j].c_str(), stdout); nfail += fails[j]; }
+  releaseOclDevices();
+  return nfail ? 1 : 0;
+}
@@ -0,0 +1,184 @@
+/* This project is licensed under the terms of the Creative Commons CC
+ * BY-NC 4.0 license. */
+
+// Single-pass scanner of OpenCL C sources: the names and signatures of every
+// kernel, as parsed by oclKernel.parseSource. Comments, string literals,
+// preprocessor lines (with continuations) and attributes (with arguments,
+// e.g. __attribute__((reqd_work_group_size(64,1,1)))) are skipped.
+// Results are kept per content hash, so unchanged sources are not rescanned.
+
+#include "matrix.h"
+#include "mex.h"
+#include "tmwtypes.h"
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ocl_hash.hpp" // fnv1a
+
+// kernels of a source: names and signatures ("kernel void name(args")
+struct ScanResult {
+  std::vector<std::string> names, sigs;
+};
+
+static bool isWord(char c){
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+// tokens of the source: words (identifiers and numbers), literals, and
+// single punctuation characters
+static std::vector<std::string> tokenize(std::string const& s){
+  std::vector<std::string> toks;
+  const size_t n = s.size();
+  bool bol = true; // at the beginning of a line (but for whitespace)
+  for (size_t i = 0; i < n;) {
+    const char c = s[i];
+    if (c == '\n') { bol = true; ++i; continue; }
+    if (c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v') { ++i; continue; }
+    if (c == '/' && i + 1 < n && s[i+1] == '/') { // line comment
+      while (i < n && s[i] != '\n') i += (s[i] == '\\' && i + 1 < n) ? 2 : 1;
+      continue;
+    }
+    if (c == '/' && i + 1 < n && s[i+1] == '*') { // block comment
+      const size_t e = s.find("*/", i + 2);
+      i = e == std::string::npos ? n : e + 2;
+      continue;
+    }
+    if (c == '#' && bol) { // preprocessor line (with continuations and comments)
+      while (i < n && s[i] != '\n') {
+        if (s[i] == '\\' && i + 1 < n) i += 2;
+        else if (s[i] == '/' && i + 1 < n && s[i+1] == '*') { const size_t e = s.find("*/", i + 2); i = e == std::string::npos ? n : e + 2; }
+        else ++i;
+      }
+      continue;
+    }
+    bol = false;
+    if (c == '"' || c == '\'') { // literal
+      size_t j = i + 1;
+      while (j < n && s[j] != c && s[j] != '\n') j += (s[j] == '\\') ? 2 : 1;
+      j = std::min(j + 1, n);
+      toks.push_back(s.substr(i, j - i));
+      i = j;
+      continue;
+    }
+    if (isWord(c)) {
+      size_t j = i;
+      while (j < n && isWord(s[j])) ++j;
+      toks.push_back(s.substr(i, j - i));
+      i = j;
+      continue;
+    }
+    toks.push_back(std::string(1, c));
+    ++i;
+  }
+  return toks;
+}
+
+// index after the balanced brackets opening at toks[i] (toks.size() if unbalanced)
+static size_t skipBalanced(std::vector<std::string> const& toks, size_t i, const char * open, const char * close){
+  int depth = 0;
+  for (; i < toks.size(); ++i) {
+    if (toks[i] == open) ++depth;
+    else if (toks[i] == close && --depth == 0) return i + 1;
+  }
+  return i;
+}
+
+// index after any attributes at toks[i]
+static size_t skipAttributes(std::vector<std::string> const& toks, size_t i){
+  for (;;) {
+    if (i + 1 < toks.size() && (toks[i] == "__attribute__" || toks[i] == "__attribute") && toks[i+1] == "(") {
+      i = skipBalanced(toks, i + 1, "(", ")");
+    } else if (i + 1 < toks.size() && toks[i] == "[" && toks[i+1] == "[") { // [[attr]]
+      i = skipBalanced(toks, i, "[", "]");
+    } else {
+      return i;
+    }
+  }
+}
+
+static ScanResult scanSource(std::string const& src){
+  const std::vector<std::string> toks = tokenize(src);
+  ScanResult r;
+  for (size_t i = 0; i < toks.size(); ++i) {
+    if (toks[i] != "kernel" && toks[i] != "__kernel") continue;
+    size_t j = skipAttributes(toks, i + 1);
+    if (j >= toks.size() || toks[j] != "void") continue;
+    j = skipAttributes(toks, j + 1);
+    if (j + 1 >= toks.size() || !isWord(toks[j][0]) || toks[j+1] != "(") continue;
+    const std::string name = toks[j];
+
+    // arguments up to the closing parenthesis, without attributes: words
+    // are separated by a space, punctuation as written in C
+    std::string args;
+    int depth = 0;
+    size_t k = j + 2;
+    for (; k < toks.size(); ++k) {
+      k = skipAttributes(toks, k);
+      if (k >= toks.size()) break;
+      std::string const& t = toks[k];
+      if (t == "(") ++depth;
+      if (t == ")" && depth-- == 0) break;
+      const bool tight = args.empty() || t == "," || t == ")" || t == "[" || t == "]"
+          || args.back() == '(' || args.back() == '[';
+      if (!tight) args += ' ';
+      args += t;
+    }
+    if (k >= toks.size()) break; // unterminated
+    r.names.push_back(name);
+    r.sigs.push_back("kernel void " + name + "(" + args);
+    i = k;
+  }
+  return r;
+}
+
+// cellstr from strings
+static mxArray * mxCellstr(std::vector<std::string> const& s){
+  mxArray * c = mxCreateCellMatrix(1, s.size());
+  for (size_t i = 0; i < s.size(); ++i) mxSetCell(c, i, mxCreateString(s[i].c_str()));
+  return c;
+}
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+
+    // input:  source (, whether the source is a file name)
+    // output: {kernel names}, {kernel signatures}
+
+  if(nrhs < 1 || !mxIsChar(prhs[0])){
+    mexErrMsgIdAndTxt("MatCL:cl_scan_source:InvalidInput", "Usage: [names, sigs] = cl_scan_source(source, isfile).");
+    return;
+  }
+  char * c = mxArrayToString(prhs[0]);
+  std::string src(c);
+  mxFree(c);
+
+  // read the file
+  const bool isfile = nrhs > 1 && mxIsScalar(prhs[1]) && mxGetScalar(prhs[1]) != 0;
+  if (isfile) {
+    std::ifstream f(src.c_str(), std::ios::binary);
+    if(!f){
+      mexErrMsgIdAndTxt("MatCL:cl_scan_source:FileNotFound", "Unable to read %s.", src.c_str());
+      return;
+    }
+    std::stringstream ss;
+    ss << f.rdbuf();
+    src = ss.str();
+  }
+
+  // scan (once per content) - entries are few, so the table is simply
+  // emptied when full
+  static std::map<uint64_t, ScanResult> scans;
+  const uint64_t h = fnv1a(src);
+  std::map<uint64_t, ScanResult>::iterator it = scans.find(h);
+  if (it == scans.end()) {
+    if (scans.size() >= 256) scans.clear();
+    it = scans.insert(std::make_pair(h, scanSource(src))).first;
+  }
+
+  plhs[0] = mxCellstr(it->second.names);
+  if (nlhs > 1) plhs[1] = mxCellstr(it->second.sigs);
+}
@@ -0,0 +1,7 @@
+function compile_cl_launcher
+% mex -R2018a -g COMPFLAGS='$COMPFLAGS -std=c++11 -O2' '-LC /usr/lib/x86_64-linux-gnu' -lOpenCL cl_launcher.cpp -I../sub/MatCL/src -outdir src/
+fpath = fileparts(mfilename("fullpath")); % this file's path
+opts = ["-R2018a" "-g" "COMPFLAGS='$COMPFLAGS -std=c++11 -O2'" "-LC /usr/lib/x86_64-linux-gnu" "-lOpenCL" fullfile(fpath,"cl_launcher.cpp") "-I"+fullfile(fpath,"..","sub","MatCL","src") "-outdir" fullfile(fpath,"..")];
+if isunix, opts(end+1) = "LDFLAGS='$LDFLAGS -pthread -ldl'"; end % build threads, IL entry points
+opts = cellstr(opts);
+mex(opts{:});
@@ -0,0 +1,6 @@
+function compile_cl_scan_source
+% mex -R2018a COMPFLAGS='$COMPFLAGS -std=c++11 -O2' cl_scan_source.cpp -outdir src/
+fpath = fileparts(mfilename("fullpath")); % this file's path
+opts = ["-R2018a" "COMPFLAGS='$COMPFLAGS -std=c++11 -O2'" fullfile(fpath,"cl_scan_source.cpp") "-outdir" fullfile(fpath,"..")];
+opts = cellstr(opts);
+mex(opts{:});
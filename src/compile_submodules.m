@@ -16,6 +16,17 @@ cd(og); % restore cwd
 if force || ~exist("cl_get_device_info."+mexext, 'file')
     compile_cl_get_device_info; % compile
 end
+if force || ~exist("cl_launcher."+mexext, 'file')
+    compile_cl_launcher; % compile
+end
+if force || ~exist("cl_scan_source."+mexext, 'file')
+    compile_cl_scan_source; % compile
+end
+exe = fullfile(fileparts(mfilename('fullpath')), "..", "cl_precompile"); % command line tool
+if ispc, exe = exe + ".exe"; end
+if force || ~isfile(exe)
+    compile_cl_precompile; % compile
+end
 
 function compile_matcl
 if     isunix,  compile_linux; 
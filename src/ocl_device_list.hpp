@@ -0,0 +1,125 @@
+/* This project is licensed under the terms of the Creative Commons CC
+ * BY-NC 4.0 license. */
+
+// Device enumeration shared by the mex-files in this folder. Each mex-file
+// holds its own copy of the cache, so devices must be enumerated (and
+// partitioned) in the same order to agree on the device indices.
+//
+// N.B. no mx calls: mex-files register releaseOclDevices (or a function
+// calling it) via mexAtExit themselves.
+
+#ifndef OCL_DEVICE_LIST_HPP
+#define OCL_DEVICE_LIST_HPP
+
+#include <string.h>
+#include <vector>
+
+#include "ocl_dev_mgr.hpp" // use the same settings as in the MatCL dependency
+#include <CL/cl.h>
+
+// process-lifetime platform/device cache: enumerated on first use,
+// released when the mex-file is cleared or MATLAB exits
+static std::vector<cl::Platform> * ocl_platforms = NULL;
+static std::vector<cl::Device> * ocl_devices = NULL;
+
+static inline void releaseOclDevices(){
+  delete ocl_devices; // releases each cl::Device
+  delete ocl_platforms;
+  ocl_devices = NULL;
+  ocl_platforms = NULL;
+}
+
+static inline std::vector<cl::Device> const& getOclDevices(bool refresh = false){
+
+  // drop the cached devices if requested
+  if (refresh) releaseOclDevices();
+
+  // return the cached devices if they exist
+  if (ocl_devices) return *ocl_devices;
+
+  // Variables
+  std::vector<cl::Device> devs, tmp; // devices
+  std::vector<cl::Platform> platforms; // platforms
+
+  // get devices per platform devices
+  cl::Platform::get(&platforms); // all platforms
+  for (cl::Platform const& p : platforms){ // for each platform
+    p.getDevices(CL_DEVICE_TYPE_ALL, &tmp);
+    devs.insert(devs.end(), tmp.begin(), tmp.end());
+  }
+
+  // cache until cleared
+  ocl_platforms = new std::vector<cl::Platform>(platforms);
+  ocl_devices = new std::vector<cl::Device>(devs);
+
+  return *ocl_devices;
+}
+
+static inline std::vector<cl::Platform> const& getOclPlatforms(){
+  getOclDevices(); // ensure the cache exists
+  return *ocl_platforms;
+}
+
+// partition properties for clCreateSubDevices - empty if invalid
+// mode 'equally'  - vals: compute units per sub-device
+// mode 'counts'   - vals: compute units of each sub-device
+// mode 'affinity' - domain: one of 'numa', 'l4', 'l3', 'l2', 'l1', 'next'
+static inline std::vector<cl_device_partition_property> partitionProperties(const char * mode, std::vector<double> const& vals, const char * domain){
+  std::vector<cl_device_partition_property> props;
+  if (!strcmp(mode, "equally") && vals.size() == 1) {
+    props = {CL_DEVICE_PARTITION_EQUALLY, (cl_device_partition_property) vals[0], 0};
+  } else if (!strcmp(mode, "counts") && !vals.empty()) {
+    props.push_back(CL_DEVICE_PARTITION_BY_COUNTS);
+    for (double const& v : vals) {props.push_back((cl_device_partition_property) v);}
+    props.push_back(CL_DEVICE_PARTITION_BY_COUNTS_LIST_END);
+    props.push_back(0);
+  } else if (!strcmp(mode, "affinity") && domain) {
+    cl_device_affinity_domain a = 0;
+    if (!strcmp(domain, "numa")) a = CL_DEVICE_AFFINITY_DOMAIN_NUMA;
+    if (!strcmp(domain, "l4"  )) a = CL_DEVICE_AFFINITY_DOMAIN_L4_CACHE;
+    if (!strcmp(domain, "l3"  )) a = CL_DEVICE_AFFINITY_DOMAIN_L3_CACHE;
+    if (!strcmp(domain, "l2"  )) a = CL_DEVICE_AFFINITY_DOMAIN_L2_CACHE;
+    if (!strcmp(domain, "l1"  )) a = CL_DEVICE_AFFINITY_DOMAIN_L1_CACHE;
+    if (!strcmp(domain, "next")) a = CL_DEVICE_AFFINITY_DOMAIN_NEXT_PARTITIONABLE;
+    if (a) props = {CL_DEVICE_PARTITION_BY_AFFINITY_DOMAIN, (cl_device_partition_property) a, 0};
+  }
+  return props;
+}
+
+// partition a cached device into sub-devices, appended to the cache
+// returns the (1-based) indices of the new sub-devices
+static inline std::vector<size_t> partitionOclDevice(size_t idx, std::vector<cl_device_partition_property> const& props){
+  std::vector<size_t> inds;
+  if (idx < 1 || idx > getOclDevices().size()) return inds;
+  const cl_device_id d = (*ocl_devices)[idx - 1]();
+
+  cl_uint n = 0;
+  cl_int err = clCreateSubDevices(d, props.data(), 0, NULL, &n);
+  if (err != CL_SUCCESS || !n) return inds;
+  std::vector<cl_device_id> subs(n);
+  if (clCreateSubDevices(d, props.data(), n, subs.data(), NULL) != CL_SUCCESS) return inds;
+
+  for (cl_device_id const& sub : subs){
+    ocl_devices->push_back(cl::Device(sub)); // takes ownership
+    inds.push_back(ocl_devices->size());
+  }
+  return inds;
+}
+
+// index of a device within the cache (0 if not found)
+static inline cl_uint deviceIndex(cl_device_id d){
+  for (size_t k = 0; d && k < ocl_devices->size(); ++k){
+    if ((*ocl_devices)[k]() == d) return (cl_uint) (k + 1);
+  }
+  return 0;
+}
+
+// index of a platform within the cache (0 if not found)
+static inline cl_uint platformIndex(cl_platform_id p){
+  for (size_t k = 0; k < ocl_platforms->size(); ++k){
+    if ((*ocl_platforms)[k]() == p) return (cl_uint) (k + 1);
+  }
+  return 0;
+}
+
+#endif
@@ -0,0 +1,25 @@
+/* This project is licensed under the terms of the Creative Commons CC
+ * BY-NC 4.0 license. */
+
+// OpenCL version of a device, encoded as 100 * major + 10 * minor (e.g. 210
+// for "OpenCL 2.1 <vendor>"), as are the OpenCL C versions in oclDevice.
+//
+// N.B. no mx calls: shared by the mex-files and command line tools.
+
+#ifndef OCL_DEVICE_VERSION_HPP
+#define OCL_DEVICE_VERSION_HPP
+
+#include <stdio.h>
+
+#include <CL/cl.h>
+
+// OpenCL version of a device (0 if unknown)
+static inline int deviceVersion(cl_device_id d){
+  char ver[256] = {0};
+  int major = 0, minor = 0;
+  if (clGetDeviceInfo(d, CL_DEVICE_VERSION, sizeof(ver) - 1, ver, NULL) != CL_SUCCESS
+    || sscanf(ver, "OpenCL %d.%d", &major, &minor) != 2) return 0;
+  return 100 * major + 10 * minor;
+}
+
+#endif
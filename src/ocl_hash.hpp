@@ -0,0 +1,29 @@
+/* This project is licensed under the terms of the Creative Commons CC
+ * BY-NC 4.0 license. */
+
+// Content hashes for cache keys and fingerprints.
+//
+// N.B. no dependencies (no mx or OpenCL calls): shared by every mex-file
+// and command line tool.
+
+#ifndef OCL_HASH_HPP
+#define OCL_HASH_HPP
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+
+// 64-bit FNV-1a hash
+static inline uint64_t fnv1a(std::string const& s, uint64_t h = 14695981039346656037ULL){
+  for (char const& c : s) { h ^= (unsigned char) c; h *= 1099511628211ULL; }
+  return h;
+}
+
+// 16 digit lower-case hex
+static inline std::string hex64(uint64_t h){
+  char buf[17];
+  snprintf(buf, sizeof(buf), "%016llx", (unsigned long long) h);
+  return buf;
+}
+
+#endif
@@ -0,0 +1,108 @@
+/* This project is licensed under the terms of the Creative Commons CC
+ * BY-NC 4.0 license. */
+
+// Programs from intermediate language (SPIR-V) modules. The headers pin
+// OpenCL 1.2, so the entry points are resolved at run time: the core
+// clCreateProgramWithIL (2.1) from the ICD loader, or clCreateProgramWithILKHR
+// (cl_khr_il_program) from the platform, and the core
+// clSetProgramSpecializationConstant (2.2) for specialization constants.
+//
+// N.B. no mx calls: shared by the mex-files and command line tools.
+
+#ifndef OCL_IL_PROGRAM_HPP
+#define OCL_IL_PROGRAM_HPP
+
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+#include <CL/cl.h>
+
+#include "ocl_device_version.hpp" // deviceVersion
+
+#ifndef CL_DEVICE_IL_VERSION
+#define CL_DEVICE_IL_VERSION 0x105B // also CL_DEVICE_IL_VERSION_KHR
+#endif
+
+typedef cl_program (CL_API_CALL * ocl_create_program_with_il_t)(cl_context, const void *, size_t, cl_int *);
+typedef cl_int (CL_API_CALL * ocl_set_program_spec_constant_t)(cl_program, cl_uint, size_t, const void *);
+
+// specialization constant: SpecId and value (of the size of its type)
+struct SpecConstant {
+  cl_uint id;
+  std::vector<unsigned char> value;
+};
+
+// serialized specialization constants, for the cache key of a program
+static inline std::string specContents(std::vector<SpecConstant> const& specs){
+  std::string s;
+  for (SpecConstant const& c : specs) {
+    s += std::to_string(c.id) + ":" + std::string(c.value.begin(), c.value.end()) + '\0';
+  }
+  return s;
+}
+
+// core entry point exported by the ICD loader (NULL if too old)
+static inline void * oclCoreFunction(const char * name){
+#ifdef _WIN32
+  HMODULE m = GetModuleHandleA("OpenCL.dll");
+  return m ? (void *) GetProcAddress(m, name) : NULL;
+#else
+  return dlsym(RTLD_DEFAULT, name);
+#endif
+}
+
+// whether a device accepts SPIR-V modules (CL_DEVICE_IL_VERSION)
+static inline bool deviceSupportsIL(cl_device_id d){
+  size_t n = 0;
+  if (clGetDeviceInfo(d, CL_DEVICE_IL_VERSION, 0, NULL, &n) != CL_SUCCESS || n < 2) return false;
+  std::string v(n, '\0');
+  clGetDeviceInfo(d, CL_DEVICE_IL_VERSION, n, &v[0], NULL);
+  return v.find("SPIR-V") != std::string::npos;
+}
+
+// create (but do not build) a program from a SPIR-V module for a device,
+// setting its specialization constants - NULL on failure with the reason in msg
+static inline cl_program createProgramWithIL(cl_context ctx, cl_device_id d, std::string const& il,
+    std::vector<SpecConstant> const& specs, std::string & msg){
+  if (!deviceSupportsIL(d)) { msg = "The device does not support SPIR-V (CL_DEVICE_IL_VERSION)."; return NULL; }
+
+  // core (2.1) or extension entry point
+  ocl_create_program_with_il_t create = NULL;
+  if (deviceVersion(d) >= 210) create = (ocl_create_program_with_il_t) oclCoreFunction("clCreateProgramWithIL");
+  if (!create) {
+    cl_platform_id p;
+    if (clGetDeviceInfo(d, CL_DEVICE_PLATFORM, sizeof(p), &p, NULL) == CL_SUCCESS)
+      create = (ocl_create_program_with_il_t) clGetExtensionFunctionAddressForPlatform(p, "clCreateProgramWithILKHR");
+  }
+  if (!create) { msg = "clCreateProgramWithIL is not available on this platform."; return NULL; }
+
+  ocl_set_program_spec_constant_t set = NULL;
+  if (!specs.empty()) {
+    if (deviceVersion(d) >= 220) set = (ocl_set_program_spec_constant_t) oclCoreFunction("clSetProgramSpecializationConstant");
+    if (!set) { msg = "Specialization constants require OpenCL 2.2 (clSetProgramSpecializationConstant)."; return NULL; }
+  }
+
+  cl_int err;
+  cl_program p = create(ctx, il.data(), il.size(), &err);
+  if (err != CL_SUCCESS) { msg = "clCreateProgramWithIL failed (" + std::to_string(err) + ")."; return NULL; }
+  for (SpecConstant const& c : specs) {
+    err = set(p, c.id, c.value.size(), c.value.data());
+    if (err != CL_SUCCESS) {
+      msg = "Unable to set specialization constant " + std::to_string(c.id) + " (" + std::to_string(err) + ").";
+      clReleaseProgram(p);
+      return NULL;
+    }
+  }
+  return p;
+}
+
+#endif
@@ -0,0 +1,316 @@
+/* This project is licensed under the terms of the Creative Commons CC
+ * BY-NC 4.0 license. */
+
+// On-disk cache of compiled program binaries (CL_PROGRAM_BINARIES), keyed by
+// the source content hash, the build options, the device name and the driver
+// version, with the kernel argument metadata of the program (which drivers
+// need not keep in a binary). Entries are written atomically (temporary
+// file + rename) under a per-entry file lock, so concurrent processes (e.g.
+// parpool workers) build each entry once and never read a partial file.
+//
+// N.B. no mx calls: shared by the mex-files and command line tools.
+
+#ifndef OCL_PROGRAM_CACHE_HPP
+#define OCL_PROGRAM_CACHE_HPP
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#define NOMINMAX
+#include <windows.h>
+#define getpid _getpid
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+#include <CL/cl.h>
+
+#include "ocl_hash.hpp" // fnv1a, hex64
+#include "ocl_il_program.hpp" // programs from SPIR-V
+
+#define OCL_PROGRAM_CACHE_MAGIC "MOCLBIN2"
+
+// string-valued device property ("" on failure)
+static inline std::string deviceString(cl_device_id d, cl_device_info id){
+  size_t n = 0;
+  if (clGetDeviceInfo(d, id, 0, NULL, &n) != CL_SUCCESS || !n) return "";
+  std::string s(n, '\0');
+  clGetDeviceInfo(d, id, n, &s[0], NULL);
+  return s.c_str(); // trim the terminator
+}
+
+// full cache key of a program: device name | driver version | options |
+// source hash (| hash of the headers it includes)
+static inline std::string programCacheKey(cl_device_id d, std::string const& src, std::string const& deps, std::string const& opts){
+  return deviceString(d, CL_DEVICE_NAME) + "|" + deviceString(d, CL_DRIVER_VERSION) + "|" + opts + "|" + hex64(fnv1a(src))
+    + (deps.empty() ? "" : "|" + hex64(fnv1a(deps)));
+}
+
+// contents of the headers a program includes, for its cache key: the
+// hashes of their contents, independent of their paths and order, so that
+// a cache can be filled elsewhere (see cl_precompile)
+static inline std::string headerContents(std::vector<std::string> const& files){
+  std::vector<std::string> hashes;
+  for (std::string const& f : files) {
+    std::ifstream h(f.c_str(), std::ios::binary);
+    std::stringstream ss;
+    if (h) ss << h.rdbuf();
+    hashes.push_back(hex64(fnv1a(ss.str())));
+  }
+  std::sort(hashes.begin(), hashes.end());
+  std::string deps;
+  for (std::string const& h : hashes) deps += h;
+  return deps;
+}
+
+// cache file of a key
+static inline std::string programCachePath(std::string const& dir, std::string const& key){
+  return dir + "/" + hex64(fnv1a(key)) + ".clbin";
+}
+
+// read a cached binary and its argument metadata - false if missing,
+// corrupt, or for another key
+// format: magic | key length | key | binary length | binary | metadata length | metadata
+static inline bool loadProgramBinary(std::string const& path, std::string const& key, std::vector<unsigned char> & bin, std::string & meta){
+  std::ifstream f(path.c_str(), std::ios::binary);
+  if (!f) return false;
+  char magic[sizeof(OCL_PROGRAM_CACHE_MAGIC) - 1];
+  uint64_t n = 0;
+  if (!f.read(magic, sizeof(magic)) || memcmp(magic, OCL_PROGRAM_CACHE_MAGIC, sizeof(magic))) return false;
+  if (!f.read((char *) &n, sizeof(n)) || n != key.size()) return false;
+  std::string k(n, '\0');
+  if (!f.read(&k[0], n) || k != key) return false; // hash collision
+  if (!f.read((char *) &n, sizeof(n)) || !n) return false;
+  bin.resize(n);
+  if (!f.read((char *) bin.data(), n) || !f.read((char *) &n, sizeof(n))) return false;
+  meta.assign(n, '\0');
+  return !n || (bool) f.read(&meta[0], n);
+}
+
+// write a cached binary atomically - false on failure
+static inline bool saveProgramBinary(std::string const& path, std::string const& key, std::vector<unsigned char> const& bin, std::string const& meta){
+  const std::string tmp = path + "." + std::to_string(getpid()) + ".tmp";
+  {
+    std::ofstream f(tmp.c_str(), std::ios::binary | std::ios::trunc);
+    if (!f) return false;
+    const uint64_t nk = key.size(), nb = bin.size(), nm = meta.size();
+    f.write(OCL_PROGRAM_CACHE_MAGIC, sizeof(OCL_PROGRAM_CACHE_MAGIC) - 1);
+    f.write((const char *) &nk, sizeof(nk));
+    f.write(key.data(), nk);
+    f.write((const char *) &nb, sizeof(nb));
+    f.write((const char *) bin.data(), nb);
+    f.write((const char *) &nm, sizeof(nm));
+    f.write(meta.data(), nm);
+    if (!f.flush()) { f.close(); remove(tmp.c_str()); return false; }
+  }
+#ifdef _WIN32
+  const bool ok = MoveFileExA(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+  const bool ok = rename(tmp.c_str(), path.c_str()) == 0;
+#endif
+  if (!ok) remove(tmp.c_str());
+  return ok;
+}
+
+// exclusive lock on a cache entry for the lifetime of the object
+// (a no-op if the lock file cannot be created, e.g. a read-only cache)
+struct ProgramCacheLock {
+#ifdef _WIN32
+  HANDLE h;
+  explicit ProgramCacheLock(std::string const& path) {
+    h = CreateFileA((path + ".lock").c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_ALWAYS, 0, NULL);
+    OVERLAPPED ov = {};
+    if (h != INVALID_HANDLE_VALUE) LockFileEx(h, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &ov);
+  }
+  ~ProgramCacheLock() {
+    OVERLAPPED ov = {};
+    if (h != INVALID_HANDLE_VALUE) { UnlockFileEx(h, 0, 1, 0, &ov); CloseHandle(h); }
+  }
+#else
+  int fd;
+  explicit ProgramCacheLock(std::string const& path) {
+    fd = open((path + ".lock").c_str(), O_RDWR | O_CREAT, 0666);
+    if (fd >= 0) flock(fd, LOCK_EX);
+  }
+  ~ProgramCacheLock() {
+    if (fd >= 0) { flock(fd, LOCK_UN); close(fd); }
+  }
+#endif
+  ProgramCacheLock(ProgramCacheLock const&) = delete;
+  ProgramCacheLock& operator=(ProgramCacheLock const&) = delete;
+};
+
+// compiled binary of a program built for a single device
+static inline std::vector<unsigned char> programBinary(cl_program p){
+  std::vector<unsigned char> bin;
+  size_t n = 0;
+  if (clGetProgramInfo(p, CL_PROGRAM_BINARY_SIZES, sizeof(n), &n, NULL) != CL_SUCCESS || !n) return bin;
+  bin.resize(n);
+  unsigned char * ptr = bin.data();
+  if (clGetProgramInfo(p, CL_PROGRAM_BINARIES, sizeof(ptr), &ptr, NULL) != CL_SUCCESS) bin.clear();
+  return bin;
+}
+
+// build log of a program on a device
+static inline std::string programBuildLog(cl_program p, cl_device_id d){
+  size_t n = 0;
+  clGetProgramBuildInfo(p, d, CL_PROGRAM_BUILD_LOG, 0, NULL, &n);
+  std::string log(n, '\0');
+  if (n) clGetProgramBuildInfo(p, d, CL_PROGRAM_BUILD_LOG, n, &log[0], NULL);
+  return log.c_str(); // trim the terminator
+}
+
+// kernel argument metadata of a program built with -cl-kernel-arg-info: one
+// line per argument of each kernel, with the tab separated fields kernel,
+// address qualifier, access qualifier, type qualifiers, type name, and
+// argument name ("" if unavailable, e.g. for IL programs)
+static inline std::string programArgInfo(cl_program p){
+  size_t n = 0;
+  if (clGetProgramInfo(p, CL_PROGRAM_KERNEL_NAMES, 0, NULL, &n) != CL_SUCCESS || !n) return "";
+  std::string names(n, '\0');
+  clGetProgramInfo(p, CL_PROGRAM_KERNEL_NAMES, n, &names[0], NULL);
+
+  std::string meta;
+  std::stringstream ss(names.c_str());
+  for (std::string nm; std::getline(ss, nm, ';');) {
+    if (nm.empty()) continue;
+    cl_int err;
+    const cl_kernel k = clCreateKernel(p, nm.c_str(), &err);
+    if (err != CL_SUCCESS) return "";
+    cl_uint na = 0;
+    clGetKernelInfo(k, CL_KERNEL_NUM_ARGS, sizeof(na), &na, NULL);
+    for (cl_uint i = 0; i < na; ++i) {
+      cl_kernel_arg_address_qualifier addr;
+      cl_kernel_arg_access_qualifier acc;
+      cl_kernel_arg_type_qualifier qual;
+      char typ[256] = "", arg[256] = "";
+      if (clGetKernelArgInfo(k, i, CL_KERNEL_ARG_ADDRESS_QUALIFIER, sizeof(addr), &addr, NULL) != CL_SUCCESS
+        || clGetKernelArgInfo(k, i, CL_KERNEL_ARG_ACCESS_QUALIFIER, sizeof(acc), &acc, NULL) != CL_SUCCESS
+        || clGetKernelArgInfo(k, i, CL_KERNEL_ARG_TYPE_QUALIFIER, sizeof(qual), &qual, NULL) != CL_SUCCESS
+        || clGetKernelArgInfo(k, i, CL_KERNEL_ARG_TYPE_NAME, sizeof(typ) - 1, typ, NULL) != CL_SUCCESS) {
+        clReleaseKernel(k);
+        return ""; // not available
+      }
+      clGetKernelArgInfo(k, i, CL_KERNEL_ARG_NAME, sizeof(arg) - 1, arg, NULL);
+      meta += nm + "\t";
+      meta += addr == CL_KERNEL_ARG_ADDRESS_GLOBAL ? "global" : addr == CL_KERNEL_ARG_ADDRESS_LOCAL ? "local"
+            : addr == CL_KERNEL_ARG_ADDRESS_CONSTANT ? "constant" : "private";
+      meta += "\t";
+      meta += acc == CL_KERNEL_ARG_ACCESS_READ_ONLY ? "read_only" : acc == CL_KERNEL_ARG_ACCESS_WRITE_ONLY ? "write_only"
+            : acc == CL_KERNEL_ARG_ACCESS_READ_WRITE ? "read_write" : "none";
+      meta += "\t";
+      std::string q;
+      if (qual & CL_KERNEL_ARG_TYPE_CONST   ) q += " const";
+      if (qual & CL_KERNEL_ARG_TYPE_RESTRICT) q += " restrict";
+      if (qual & CL_KERNEL_ARG_TYPE_VOLATILE) q += " volatile";
+      meta += (q.empty() ? q : q.substr(1)) + "\t" + typ + "\t" + arg + "\n";
+    }
+    clReleaseKernel(k);
+  }
+  return meta;
+}
+
+// argument metadata of a kernel (see programArgInfo) - empty if unavailable
+struct ArgInfo {
+  std::string address, access, qualifier, type, name;
+  bool buffer() const { return address == "global" || address == "constant"; } // a cl_mem
+  bool local() const { return address == "local"; } // a size, allocated per work-group
+};
+static inline std::vector<ArgInfo> kernelArgInfo(std::string const& meta, std::string const& kernel){
+  std::vector<ArgInfo> info;
+  std::stringstream ss(meta);
+  for (std::string ln; std::getline(ss, ln);) {
+    std::stringstream ls(ln);
+    std::string k;
+    ArgInfo a;
+    std::getline(ls, k, '\t');
+    if (k != kernel) continue;
+    std::getline(ls, a.address, '\t');
+    std::getline(ls, a.access, '\t');
+    std::getline(ls, a.qualifier, '\t');
+    std::getline(ls, a.type, '\t');
+    std::getline(ls, a.name, '\t');
+    info.push_back(a);
+  }
+  return info;
+}
+
+// build a program for a single device, through the binary cache in dir
+// (disabled if dir is empty). deps identifies the included headers (see
+// headerContents). Returns NULL on failure with the reason in msg.
+// Sets cached if the program was created from a cached binary.
+// If il, src is a SPIR-V module, and deps must include its specialization
+// constants (see specContents). Sets args to the kernel argument metadata
+// (see programArgInfo): OpenCL C programs are built with -cl-kernel-arg-info.
+// Sets stored if the binary is in the cache on return (loaded or written).
+static inline cl_program buildCachedProgram(cl_context ctx, cl_device_id d, std::string const& src, std::string const& deps,
+    std::string const& options, std::string const& dir, std::string & msg, bool * cached = NULL,
+    bool il = false, std::vector<SpecConstant> const& specs = std::vector<SpecConstant>(), std::string * args = NULL,
+    bool * stored = NULL){
+  cl_int err;
+  if (cached) *cached = false;
+  if (stored) *stored = false;
+  const std::string opts = il ? options : options + " -cl-kernel-arg-info";
+
+  // serialize builds of the same entry across processes
+  const std::string key = programCacheKey(d, src, deps, opts);
+  const std::string path = dir.empty() ? "" : programCachePath(dir, key);
+  std::unique_ptr<ProgramCacheLock> lock(dir.empty() ? NULL : new ProgramCacheLock(path));
+
+  // cached binary: stale or incompatible binaries fall back to source
+  std::vector<unsigned char> bin;
+  std::string meta;
+  if (!dir.empty() && loadProgramBinary(path, key, bin, meta)) {
+    const unsigned char * b = bin.data();
+    const size_t n = bin.size();
+    cl_int status;
+    cl_program p = clCreateProgramWithBinary(ctx, 1, &d, &n, &b, &status, &err);
+    if (err == CL_SUCCESS && status == CL_SUCCESS && clBuildProgram(p, 1, &d, opts.c_str(), NULL, NULL) == CL_SUCCESS) {
+      if (cached) *cached = true;
+      if (stored) *stored = true;
+      if (args) *args = meta.empty() ? programArgInfo(p) : meta;
+      return p;
+    }
+    if (err == CL_SUCCESS) clReleaseProgram(p);
+  }
+
+  // build from source (or IL)
+  cl_program p;
+  if (il) {
+    p = createProgramWithIL(ctx, d, src, specs, msg);
+    if (!p) return NULL;
+  } else {
+    const char * s = src.c_str();
+    const size_t n = src.size();
+    p = clCreateProgramWithSource(ctx, 1, &s, &n, &err);
+    if (err != CL_SUCCESS) { msg = "clCreateProgramWithSource failed (" + std::to_string(err) + ")."; return NULL; }
+  }
+  err = clBuildProgram(p, 1, &d, opts.c_str(), NULL, NULL);
+  if (err != CL_SUCCESS) {
+    msg = "Build failed (" + std::to_string(err) + "):\n" + programBuildLog(p, d);
+    clReleaseProgram(p);
+    return NULL;
+  }
+
+  // store (best effort: see stored)
+  meta = programArgInfo(p);
+  if (args) *args = meta;
+  if (!dir.empty()) {
+    bin = programBinary(p);
+    const bool ok = !bin.empty() && saveProgramBinary(path, key, bin, meta);
+    if (stored) *stored = ok;
+  }
+  return p;
+}
+
+#endif